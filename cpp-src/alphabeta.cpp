@@ -0,0 +1,281 @@
+// ##########################################################################
+// #             Alpha-beta search engine
+// ##########################################################################
+
+#include "alphabeta.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+// scores within max_plies of win_score are wins: stored in the table relative to the node
+static const int max_plies = 1000;
+static const int leaf_limit = AlphaBeta::win_score / 2;
+
+static int to_table(int score, int ply)
+{
+    if (score > AlphaBeta::win_score - max_plies)
+        return score + ply;
+    if (score < -AlphaBeta::win_score + max_plies)
+        return score - ply;
+    return score;
+}
+
+static int from_table(int score, int ply)
+{
+    if (score > AlphaBeta::win_score - max_plies)
+        return score - ply;
+    if (score < -AlphaBeta::win_score + max_plies)
+        return score + ply;
+    return score;
+}
+
+static Hex::Marker opponent(Hex::Marker side)
+{
+    return (side == Hex::Marker::playerX ? Hex::Marker::playerO : Hex::Marker::playerX);
+}
+
+AlphaBeta::AlphaBeta(LeafEval leaf, int tt_bits) : leaf(leaf)
+{
+    table.resize(size_t(1) << tt_bits);
+    table_mask = table.size() - 1;
+}
+
+int AlphaBeta::two_distance_leaf(Hex &hb, Hex::Marker side)
+{
+    // static_eval is about +-path_blocked when a side has no path left: scale in 64 bits
+    return int(clamp(int64_t(100) * hb.static_eval(side), int64_t(-leaf_limit), int64_t(leaf_limit)));
+}
+
+int AlphaBeta::resistance_leaf(Hex &hb, Hex::Marker side)
+{
+    return int(clamp(1000 * hb.resistance_eval(side), double(-leaf_limit), double(leaf_limit)));
+}
+
+int AlphaBeta::network_leaf(Hex &hb, Hex::Marker side)
+{
+    thread_local NnOutput out;
+    if (hb.network == nullptr)
+        return two_distance_leaf(hb, side);
+    hb.network->evaluate(hb, side, out);
+    return int(10000 * out.value);
+}
+
+void AlphaBeta::clear()
+{
+    fill(table.begin(), table.end(), TTEntry{});
+    fill(history.begin(), history.end(), 0);
+    for (auto &k : killers)
+        k = {-1, -1};
+}
+
+// size the per-move and per-ply tables for the board: only when the board size changes
+void AlphaBeta::setup(const Hex &hb)
+{
+    int n = hb.get_edge_len();
+    if (max_idx == n * n)
+        return;
+    max_idx = n * n;
+    fill(table.begin(), table.end(), TTEntry{}); // positions of another board size
+    killers.assign(max_idx + 1, {-1, -1});
+    history.assign(2 * max_idx, 0);
+    move_lists.resize(max_idx + 1);
+    for (auto &ml : move_lists)
+        ml.reserve(max_idx);
+    center_bonus.resize(max_idx);
+    int mid = n / 2;
+    for (int idx = 0; idx != max_idx; ++idx) {
+        int r = idx / n, c = idx % n;
+        center_bonus[idx] = n - (abs(r - mid) + abs(c - mid) + abs((r - mid) + (c - mid))) / 2; // hex distance
+    }
+}
+
+bool AlphaBeta::out_of_time()
+{
+    if (aborted)
+        return true;
+    if (!timed || stats.depth == 0 || (stats.nodes & 1023) != 0)
+        return false; // the first iteration always finishes so there is always a move
+    aborted = chrono::steady_clock::now() >= deadline;
+    return aborted;
+}
+
+void AlphaBeta::order_moves(const Hex &hb, Hex::Marker side, int ply, int tt_move)
+{
+    int s = (side == Hex::Marker::playerX ? 0 : 1);
+    auto &moves = move_lists[ply];
+    moves.clear();
+    bool use_priors = hb.network != nullptr && ply < prior_plies;
+    if (use_priors)
+        hb.network->evaluate(hb, side, priors);
+    for (int idx : hb.get_empty_idxs()) {
+        int score = (use_priors ? int(priors.policy[idx] * (1 << 20)) : history[2 * idx + s] * 16 + center_bonus[idx]);
+        if (idx == tt_move)
+            score = 1 << 30;
+        else if (idx == killers[ply][0])
+            score = 1 << 29;
+        else if (idx == killers[ply][1])
+            score = 1 << 28;
+        moves.emplace_back(score, idx);
+    }
+    sort(moves.begin(), moves.end(), [](const pair<int, int> &a, const pair<int, int> &b) { return a.first > b.first; });
+}
+
+// score of the position for side, the side to move. The opponent has not won: a side that can
+// connect with one more hex wins at its turn, so the search never gets past a won position.
+int AlphaBeta::negamax(Hex &hb, Hex::Marker side, int depth, int alpha, int beta, int ply)
+{
+    if (out_of_time())
+        return 0;
+    stats.nodes++;
+
+    if (hb.shortest_distance(side) <= 1)
+        return win_score - ply - 1;
+
+    if (ply > 0 && hb.solved_positions.is_open()) {
+        bool rotated;
+        const BookEntry *solved = hb.solved_positions.find(hb.canonical_hash(rotated));
+        if (solved != nullptr) // proven, but not how soon: count it as a slower win than any found here
+            return (solved->win_permille == 1000 ? 1 : -1) * (win_score - max_plies / 2 - ply);
+    }
+
+    uint64_t key = hb.position_hash();
+    TTEntry &entry = table[key & table_mask];
+    int tt_move = -1;
+    if (entry.key == key) {
+        tt_move = entry.move;
+        if (entry.depth >= depth && ply > 0) {
+            int score = from_table(entry.score, ply);
+            if (entry.bound == exact || (entry.bound == lower && score >= beta) ||
+                (entry.bound == upper && score <= alpha))
+                return score;
+        }
+    }
+
+    if (depth == 0)
+        return leaf(hb, side);
+
+    order_moves(hb, side, ply, tt_move);
+    Hex::Marker other = opponent(side);
+    int alpha_start = alpha;
+    int best = -win_score - 1;
+    int best_move = -1;
+    for (const auto &sm : move_lists[ply]) {
+        int move = sm.second;
+        hb.make_move(side, move);
+        int score = -negamax(hb, other, depth - 1, -beta, -alpha, ply + 1);
+        hb.unmake_move();
+        if (aborted)
+            return 0;
+
+        if (score > best) {
+            best = score;
+            best_move = move;
+        }
+        if (score > alpha)
+            alpha = score;
+        if (alpha >= beta) { // cutoff: remember the move for sibling positions
+            if (killers[ply][0] != move) {
+                killers[ply][1] = killers[ply][0];
+                killers[ply][0] = move;
+            }
+            int &h = history[2 * move + (side == Hex::Marker::playerX ? 0 : 1)];
+            h += depth * depth;
+            if (h > (1 << 20)) {
+                for (auto &x : history)
+                    x /= 2;
+            }
+            break;
+        }
+    }
+
+    if (ply == 0)
+        root_best = best_move;
+    if (entry.key != key || depth >= entry.depth) {
+        entry.key = key;
+        entry.score = to_table(best, ply);
+        entry.move = best_move;
+        entry.depth = min(depth, 127);
+        entry.bound = (best <= alpha_start ? upper : (best >= beta ? lower : exact));
+    }
+    return best;
+}
+
+int AlphaBeta::search(Hex &hb, Hex::Marker side, int depth)
+{
+    setup(hb);
+    aborted = false;
+    timed = false;
+    return negamax(hb, side, depth, -win_score - 1, win_score + 1, 0);
+}
+
+// null window search to the end of the game: only win or loss matters
+int AlphaBeta::solve(Hex &hb, Hex::Marker side, int &move)
+{
+    setup(hb);
+    move = hb.winning_move(side);
+    if (move >= 0)
+        return 1;
+    aborted = false;
+    int depth = hb.get_empty_idxs().size();
+    int score = negamax(hb, side, depth, -1, 1, 0);
+    if (aborted)
+        return 0;
+    move = root_best;
+    return (score > 0 ? 1 : -1);
+}
+
+int AlphaBeta::best_move(Hex &hb, Hex::Marker side)
+{
+    auto start = chrono::steady_clock::now();
+    deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(time_limit));
+    timed = time_limit > 0.0;
+    stats = Stats{};
+    setup(hb);
+
+    int n_empty = hb.get_empty_idxs().size();
+    int best = hb.winning_move(side);
+    if (best >= 0) {
+        stats.solved = true;
+        stats.score = win_score - 1;
+        return best;
+    }
+
+    if (exact_limit > 0 && n_empty <= exact_limit) {
+        // the solve gets half the time, so a failed solve leaves time to search for a good move
+        auto full_deadline = deadline;
+        deadline = start + (deadline - start) / 2;
+        stats.depth = 1; // let the solve be cut off by the time limit
+        int move;
+        int result = solve(hb, side, move);
+        stats.depth = 0;
+        deadline = full_deadline;
+        if (result == 1) {
+            stats.solved = true;
+            stats.score = win_score - 1;
+            stats.secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            return move;
+        }
+        // a proven loss or out of time: the search below picks the move that resists longest
+    }
+
+    best = hb.get_empty_idxs()[0];
+    for (int depth = 1; max_depth == 0 || depth <= max_depth; ++depth) {
+        aborted = false;
+        int score = negamax(hb, side, depth, -win_score - 1, win_score + 1, 0);
+        if (aborted)
+            break;
+        best = root_best;
+        stats.depth = depth;
+        stats.score = score;
+        if (abs(score) > win_score - max_plies) {
+            stats.solved = true;
+            break;
+        }
+        if (depth >= n_empty)
+            break;
+    }
+    stats.secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return best;
+}
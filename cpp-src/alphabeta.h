@@ -0,0 +1,113 @@
+// ##########################################################################
+// #             Definition/Declaration of Class AlphaBeta
+// ##########################################################################
+
+#ifndef ALPHABETA_H
+#define ALPHABETA_H
+
+/*
+A game tree search engine for the computer's moves, in place of the simulated games of
+monte_carlo_move. Best on small boards, where it can look to the end of the game.
+
+    negamax with alpha-beta pruning on the Hex board itself (make_move and unmake_move)
+    iterative deepening: depth 1, 2, 3 ... until the time is up; the deepest finished
+        search gives the move
+    transposition table keyed by Hex::position_hash, kept between moves
+    move ordering: the table's move, then 2 killer moves per ply, then the history heuristic,
+        then closeness to the center
+    a side that needs only one more hex to connect wins at once (Hex::shortest_distance)
+    positions in the solved position table (Hex::solved_positions) are not searched
+    a pluggable leaf evaluator: any function scoring a position for the side to move.
+        two_distance_leaf (Hex::static_eval), resistance_leaf (Hex::resistance_eval) and
+        network_leaf (the value of Hex::network) are provided.
+    with Hex::network set, the moves of the first prior_plies plies are ordered by the
+        network's policy instead of the history heuristic
+
+Exact solving: with exact_limit set, positions with at most exact_limit empty hexes are
+solved to the end of the game with a null window, so the result is a proven win or loss.
+solve can also be called directly. Scores above win_score - max plies are wins. best_move gives
+the solve half its time limit and searches with the rest when the solve does not finish.
+
+Use with a game:
+    AlphaBeta engine(AlphaBeta::two_distance_leaf);
+    engine.time_limit = 0.5;
+    hb.alphabeta = &engine;    // computer_move now searches instead of simulating
+*/
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "hex.h"
+#include "nn_eval.h"
+
+using namespace std;
+
+class AlphaBeta {
+  public:
+    using LeafEval = int (*)(Hex &hb, Hex::Marker side); // score for side, the side to move
+
+    static const int win_score = 1000000;
+
+    struct Stats {
+        long nodes = 0;
+        int depth = 0;        // deepest finished iteration
+        int score = 0;        // score of the best move for the side to move
+        bool solved = false;  // the score is a proven win or loss
+        double secs = 0.0;
+    };
+
+    explicit AlphaBeta(LeafEval leaf = two_distance_leaf, int tt_bits = 20);
+
+    LeafEval leaf;
+    double time_limit = 1.0; // seconds per move
+    int max_depth = 0;       // 0 => no limit besides the time
+    int exact_limit = 0;     // solve exactly when this many hexes or fewer are empty
+    int prior_plies = 2;     // plies ordered by the network's policy when there is one
+
+    int best_move(Hex &hb, Hex::Marker side); // linear index of the move to play
+    int solve(Hex &hb, Hex::Marker side, int &move); // 1 side wins, -1 side loses, 0 out of time
+    int search(Hex &hb, Hex::Marker side, int depth); // one fixed depth search: returns the score
+
+    const Stats &get_stats() const { return stats; }
+    void clear(); // forget the transposition table, killers and history
+
+    static int two_distance_leaf(Hex &hb, Hex::Marker side);
+    static int resistance_leaf(Hex &hb, Hex::Marker side);
+    static int network_leaf(Hex &hb, Hex::Marker side);
+
+  private:
+    enum Bound : uint8_t { none, exact, lower, upper };
+
+    struct TTEntry {
+        uint64_t key = 0;
+        int32_t score = 0;
+        int16_t move = -1;
+        int8_t depth = -1;
+        Bound bound = none;
+    };
+
+    vector<TTEntry> table;
+    uint64_t table_mask;
+
+    int max_idx = 0;
+    vector<array<int, 2>> killers;      // per ply
+    vector<int> history;                // index 2 * move + side
+    vector<int> center_bonus;           // prefer moves near the center when nothing else decides
+    vector<vector<pair<int, int>>> move_lists; // per ply: (order score, move)
+    NnOutput priors; // network output for the position being ordered
+
+    Stats stats;
+    chrono::steady_clock::time_point deadline;
+    bool timed = false;
+    bool aborted = false;
+    int root_best = -1;
+
+    void setup(const Hex &hb);
+    int negamax(Hex &hb, Hex::Marker side, int depth, int alpha, int beta, int ply);
+    void order_moves(const Hex &hb, Hex::Marker side, int ply, int tt_move);
+    bool out_of_time();
+};
+
+#endif
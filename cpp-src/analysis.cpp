@@ -0,0 +1,147 @@
+// ##########################################################################
+// #             Batch analysis of stored game records
+// ##########################################################################
+
+#include "analysis.h"
+
+#include <atomic>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+// replay one game and evaluate each selected position before the move was played
+GameAnalysis analyze_game(const GameRecord &game, const AnalysisOptions &opts, unsigned seed)
+{
+    GameAnalysis ga;
+    ga.source = game.source;
+    ga.edge_len = game.edge_len;
+
+    try {
+        Hex hb(game.edge_len);
+        hb.make_board();
+        hb.reseed(seed);
+
+        int last_ply = (opts.last_ply == 0 ? game.moves.size() : opts.last_ply);
+
+        for (int i = 0; i != game.moves.size(); ++i) {
+            const Hex::Move &mv = game.moves[i];
+            Hex::RowCol rc{mv.row, mv.col};
+            PlyAnalysis pa(i + 1, mv);
+
+            if (mv.row < 1 || mv.row > game.edge_len || mv.col < 1 || mv.col > game.edge_len || !hb.isblank(rc)) {
+                ga.error = "illegal move at ply " + to_string(i + 1);
+                return ga;
+            }
+
+            const vector<int> &empties = hb.get_empty_idxs();
+            if (pa.ply >= opts.first_ply && pa.ply <= last_ply && empties.size() > 1) {
+                Hex::Marker other = (mv.player == Hex::Marker::playerX ? Hex::Marker::playerO : Hex::Marker::playerX);
+                const vector<int> &wins = hb.evaluate_moves(mv.player, opts.n_trials, other);
+
+                int played = hb.rc2l(rc);
+                int best_wins = -1;
+                int played_wins = -1; // stays -1 if the played move was pruned as dead or captured
+                for (int j = 0; j != wins.size(); ++j) {
+                    if (wins[j] > best_wins) {
+                        best_wins = wins[j];
+                        pa.best = hb.l2rc(empties[j]);
+                    }
+                    if (empties[j] == played)
+                        played_wins = wins[j];
+                }
+
+                pa.evaluated = played_wins >= 0;
+                pa.played_rate = double(played_wins) / opts.n_trials;
+                pa.best_rate = double(best_wins) / opts.n_trials;
+                pa.x_win_rate = (mv.player == Hex::Marker::playerX ? pa.played_rate : 1.0 - pa.played_rate);
+                pa.blunder = (pa.best_rate - pa.played_rate) >= opts.blunder_drop;
+            }
+
+            hb.do_move(mv.player, rc);
+            ga.plies.push_back(pa);
+        }
+        ga.winner = hb.who_won();
+    }
+    catch (const exception &e) {
+        ga.error = e.what();
+    }
+
+    return ga;
+}
+
+// analyze the games in parallel: worker threads take the next game until none are left
+vector<GameAnalysis> analyze_games(const vector<GameRecord> &games, const AnalysisOptions &opts)
+{
+    vector<GameAnalysis> results(games.size());
+    atomic<int> next_game{0};
+    int n_threads = opts.n_threads > 0 ? opts.n_threads : thread::hardware_concurrency();
+    if (n_threads < 1)
+        n_threads = 1;
+    unsigned base_seed = chrono::system_clock::now().time_since_epoch().count();
+
+    auto worker = [&]() {
+        for (int g = next_game++; g < games.size(); g = next_game++) {
+            results[g] = analyze_game(games[g], opts, base_seed + 7919 * (g + 1)); // distinct seed per game
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 0; t != n_threads; ++t)
+        workers.emplace_back(worker);
+    for (auto &w : workers)
+        w.join();
+
+    return results;
+}
+
+// print the per-move report with the win-rate curve for playerX as a bar
+void print_analysis(ostream &out, const GameAnalysis &ga)
+{
+    out << "\nGame " << ga.source << ": " << ga.edge_len << "x" << ga.edge_len << ", " << ga.plies.size()
+        << " moves, winner " << marker2char(ga.winner) << "\n";
+    if (!ga.error.empty()) {
+        out << "    Error: " << ga.error << "\n";
+        if (ga.plies.empty())
+            return;
+    }
+
+    int blunders = 0;
+    out << "  ply side  move    played   best  best move  X win%\n";
+    for (const auto &pa : ga.plies) {
+        out << setw(5) << pa.ply << "    " << marker2char(pa.move.player) << setw(4) << pa.move.row << setw(3)
+            << pa.move.col;
+        if (!pa.evaluated) {
+            out << "\n";
+            continue;
+        }
+        out << fixed << setprecision(3) << setw(9) << pa.played_rate << setw(7) << pa.best_rate << setw(6)
+            << pa.best.row << setw(3) << pa.best.col << setprecision(1) << setw(10) << 100.0 * pa.x_win_rate << " "
+            << string_by_n("#", int(pa.x_win_rate * 20 + 0.5)) << (pa.blunder ? "  <-- BLUNDER" : "") << "\n";
+        blunders += pa.blunder;
+    }
+    out << "  " << blunders << " blunder" << (blunders == 1 ? "" : "s") << " flagged\n";
+}
+
+// load every game in the files, analyze them using all cores and print a report
+int run_analysis(const vector<string> &filenames, const AnalysisOptions &opts)
+{
+    vector<GameRecord> games;
+    for (const auto &fname : filenames) {
+        auto loaded = load_game_records(fname);
+        games.insert(games.end(), loaded.begin(), loaded.end());
+    }
+    cout << "Analyzing " << games.size() << " games with " << opts.n_trials << " trials per candidate move...\n";
+
+    Timing analysis_time;
+    analysis_time.start();
+    auto results = analyze_games(games, opts);
+    analysis_time.cum();
+
+    for (const auto &ga : results)
+        print_analysis(cout, ga);
+
+    cout << "\nAnalysis took " << analysis_time.show() << " seconds.\n";
+    return 0;
+}
@@ -0,0 +1,62 @@
+// ##########################################################################
+// #             Batch analysis of stored game records
+// ##########################################################################
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+/*
+Replays stored games and evaluates the positions with the monte carlo engine.
+Games are spread across worker threads; each thread owns its own Hex object so
+nothing is shared during the simulation. For every evaluated position we report
+the win rate of the move actually played, the win rate of the engine's best move,
+and flag the move as a blunder when the played move is much worse than the best.
+The win rate of the played moves, seen from playerX, gives a win-rate curve per game.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game_record.h"
+#include "hex.h"
+
+using namespace std;
+
+struct AnalysisOptions {
+    int n_trials = 1000;        // simulated games per candidate move
+    int n_threads = 0;          // 0 => one thread per core
+    double blunder_drop = 0.15; // flag a move whose win rate is this much below the best move
+    int first_ply = 1;          // 1-based range of the moves to evaluate
+    int last_ply = 0;           // 0 => through the end of the game
+};
+
+struct PlyAnalysis {
+    int ply;               // 1-based move number
+    Hex::Move move;        // the move actually played
+    bool evaluated;        // false if outside the selected plies or no choice of move
+    double played_rate;    // win rate of the played move for the side that moved
+    double best_rate;      // win rate of the engine's best move
+    Hex::RowCol best;      // the engine's best move
+    double x_win_rate;     // win rate for playerX after the move: the win-rate curve
+    bool blunder;
+
+    PlyAnalysis(int ply, Hex::Move move)
+        : ply(ply), move(move), evaluated(false), played_rate(0.0), best_rate(0.0), best(),
+          x_win_rate(0.0), blunder(false) {}
+};
+
+struct GameAnalysis {
+    string source;
+    int edge_len = 0;
+    Hex::Marker winner = Hex::Marker::empty;
+    vector<PlyAnalysis> plies;
+    string error; // not empty if the record could not be replayed
+};
+
+GameAnalysis analyze_game(const GameRecord &game, const AnalysisOptions &opts, unsigned seed);
+vector<GameAnalysis> analyze_games(const vector<GameRecord> &games, const AnalysisOptions &opts);
+void print_analysis(ostream &out, const GameAnalysis &ga);
+int run_analysis(const vector<string> &filenames, const AnalysisOptions &opts);
+
+#endif
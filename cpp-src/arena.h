@@ -0,0 +1,57 @@
+// ##########################################################################
+// #             Definition/Declaration of Class ScratchArena
+// ##########################################################################
+
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+Per-thread scratch memory for searches. Each thread has one arena (ScratchArena::for_thread)
+holding a 1 MB buffer allocated once. Containers built with std::pmr allocators on
+resource() take their memory from the buffer:
+    monotonic_buffer_resource:    bump allocation from the buffer
+    unsynchronized_pool_resource: recycles freed blocks, so containers that grow and shrink
+                                  in a loop (like the deque in find_ends) reuse the same memory
+After the first few simulated games the search loop makes no calls to malloc at all.
+reset() hands the whole buffer back in one step: the search calls it before it starts,
+so nothing built on the arena may outlive a search.
+If a search ever needs more than the buffer, the monotonic resource gets more memory
+from new and delete; the allocation counter in the benchmark shows if that happens.
+*/
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+using namespace std;
+
+class ScratchArena {
+  public:
+    explicit ScratchArena(size_t bytes = 1 << 20)
+        : buffer(bytes), mono(buffer.data(), buffer.size(), pmr::new_delete_resource()), pool(&mono)
+    {
+    }
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    pmr::memory_resource *resource() { return &pool; }
+
+    void reset()
+    {
+        pool.release();
+        mono.release(); // back to the start of the buffer
+    }
+
+    static ScratchArena &for_thread()
+    {
+        thread_local ScratchArena arena;
+        return arena;
+    }
+
+  private:
+    vector<std::byte> buffer;
+    pmr::monotonic_buffer_resource mono;
+    pmr::unsynchronized_pool_resource pool;
+};
+
+#endif
@@ -0,0 +1,183 @@
+// ##########################################################################
+// #             Definition/Declaration of Class HexBitboard
+// ##########################################################################
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+/*
+A hex board as a bitmask: bit i is linear index i, packed into 64 bit words.
+HexBitboard holds the masks for one edge length: the columns that must not wrap around
+when shifting, the 4 borders and the valid positions. The methods work on plain arrays of
+n_words words so callers can keep their bitmasks in pre-allocated scratch memory.
+
+Neighbors of linear index i on a board with edge length n:
+    i - 1 and i + n - 1   (not from the first column)
+    i + 1 and i - n + 1   (not from the last column)
+    i - n and i + n
+A path search grows the set of reached positions by all 6 shifts at once, keeping only
+the side's own positions, until it stops growing or touches the finish border.
+*/
+
+#include <cstdint>
+#include <vector>
+
+#include "playout_rng.h"
+
+using namespace std;
+
+class HexBitboard {
+  public:
+    int edge_len = 0;
+    int n_cells = 0;
+    int n_words = 0;
+    vector<uint64_t> valid;          // every position on the board
+    vector<uint64_t> not_first_col;
+    vector<uint64_t> not_last_col;
+    vector<uint64_t> top, bottom;    // playerX borders
+    vector<uint64_t> left, right;    // playerO borders
+
+    HexBitboard() = default;
+    explicit HexBitboard(int edge_len) { setup(edge_len); }
+
+    void setup(int n)
+    {
+        edge_len = n;
+        n_cells = n * n;
+        n_words = (n_cells + 63) / 64;
+        for (auto v : {&valid, &not_first_col, &not_last_col, &top, &bottom, &left, &right})
+            v->assign(n_words, 0);
+        for (int i = 0; i != n_cells; ++i) {
+            int row = i / n, col = i % n;
+            set(valid.data(), i);
+            if (col != 0)
+                set(not_first_col.data(), i);
+            if (col != n - 1)
+                set(not_last_col.data(), i);
+            if (row == 0)
+                set(top.data(), i);
+            if (row == n - 1)
+                set(bottom.data(), i);
+            if (col == 0)
+                set(left.data(), i);
+            if (col == n - 1)
+                set(right.data(), i);
+        }
+    }
+
+    static void set(uint64_t *bits, int i) { bits[i >> 6] |= uint64_t(1) << (i & 63); }
+    static void reset(uint64_t *bits, int i) { bits[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+    static bool test(const uint64_t *bits, int i) { return (bits[i >> 6] >> (i & 63)) & 1; }
+
+    int count(const uint64_t *bits) const
+    {
+        int c = 0;
+        for (int w = 0; w != n_words; ++w)
+            c += __builtin_popcountll(bits[w]);
+        return c;
+    }
+
+    // dst |= src << k (toward higher indices) or src >> k (toward lower indices)
+    void or_shift_up(uint64_t *dst, const uint64_t *src, int k) const
+    {
+        int q = k >> 6, r = k & 63;
+        for (int w = n_words - 1; w >= q; --w) {
+            uint64_t v = src[w - q] << r;
+            if (r != 0 && w - q - 1 >= 0)
+                v |= src[w - q - 1] >> (64 - r);
+            dst[w] |= v;
+        }
+    }
+
+    void or_shift_down(uint64_t *dst, const uint64_t *src, int k) const
+    {
+        int q = k >> 6, r = k & 63;
+        for (int w = 0; w + q < n_words; ++w) {
+            uint64_t v = src[w + q] >> r;
+            if (r != 0 && w + q + 1 < n_words)
+                v |= src[w + q + 1] << (64 - r);
+            dst[w] |= v;
+        }
+    }
+
+    // true if the positions in own connect the from border to the to border.
+    // scratch must hold 4 * n_words words.
+    bool connects(const uint64_t *own, const uint64_t *from, const uint64_t *to, uint64_t *scratch) const
+    {
+        uint64_t *reach = scratch;
+        uint64_t *grow = scratch + n_words;
+        uint64_t *src_nfc = scratch + 2 * n_words;
+        uint64_t *src_nlc = scratch + 3 * n_words;
+
+        bool any = false;
+        for (int w = 0; w != n_words; ++w) {
+            reach[w] = own[w] & from[w];
+            any = any || reach[w] != 0;
+        }
+
+        while (any) {
+            for (int w = 0; w != n_words; ++w) {
+                if (reach[w] & to[w])
+                    return true;
+                grow[w] = reach[w];
+                src_nfc[w] = reach[w] & not_first_col[w];
+                src_nlc[w] = reach[w] & not_last_col[w];
+            }
+            or_shift_up(grow, src_nlc, 1);              // i + 1
+            or_shift_down(grow, src_nfc, 1);            // i - 1
+            or_shift_up(grow, reach, edge_len);         // i + n
+            or_shift_down(grow, reach, edge_len);       // i - n
+            or_shift_down(grow, src_nlc, edge_len - 1); // i - n + 1
+            or_shift_up(grow, src_nfc, edge_len - 1);   // i + n - 1
+
+            any = false; // did the reached set grow?
+            for (int w = 0; w != n_words; ++w) {
+                uint64_t g = grow[w] & own[w];
+                any = any || g != reach[w];
+                reach[w] = g;
+            }
+        }
+        return false;
+    }
+
+    // pick a uniformly random subset of exactly k of the positions in mask and write it to out.
+    // Each position is first chosen with probability 1/2 using whole random words; then random
+    // chosen positions are dropped, or random unchosen ones added, until exactly k are chosen.
+    // Given its size the first subset is uniform, so the result is a uniform k-subset.
+    void random_subset(const uint64_t *mask, int k, uint64_t *out, PlayoutRng &rng) const
+    {
+        int c = 0;
+        for (int w = 0; w != n_words; ++w) {
+            out[w] = rng.next() & mask[w];
+            c += __builtin_popcountll(out[w]);
+        }
+        int n_mask = count(mask);
+        while (c > k) { // drop a random chosen position
+            flip_nth(out, out, rng.bounded(c), false);
+            --c;
+        }
+        while (c < k) { // add a random unchosen position of the mask
+            flip_nth(out, mask, rng.bounded(n_mask - c), true);
+            ++c;
+        }
+    }
+
+  private:
+    // find the nth set bit of (pool & ~bits) when adding or of bits when dropping, and flip it in bits
+    void flip_nth(uint64_t *bits, const uint64_t *pool, int nth, bool adding) const
+    {
+        for (int w = 0; w != n_words; ++w) {
+            uint64_t word = adding ? (pool[w] & ~bits[w]) : bits[w];
+            int c = __builtin_popcountll(word);
+            if (nth < c) {
+                for (int j = 0; j != nth; ++j)
+                    word &= word - 1; // clear the lowest set bit
+                bits[w] ^= word & (~word + 1); // flip the lowest remaining set bit
+                return;
+            }
+            nth -= c;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,163 @@
+// ##########################################################################
+// #             Buffered terminal renderer for the ascii hexboard
+// ##########################################################################
+
+#include "board_render.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+
+using namespace std;
+
+// some string constants used to draw the board
+static const string connector = R"( \ /)";
+static const string last_connector = R"( \)";
+static const string spacer = "___";
+
+// append a positive integer without a temporary string
+static void append_int(string &s, int n)
+{
+    char digits[12];
+    int len = 0;
+    do {
+        digits[len++] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    while (len > 0)
+        s += digits[--len];
+}
+
+static int n_digits(int n)
+{
+    int len = 1;
+    for (; n >= 10; n /= 10)
+        len++;
+    return len;
+}
+
+BoardRenderer::BoardRenderer(int edge_len, bool cursor_updates, int fd)
+    : cursor_updates(cursor_updates), edge_len(edge_len), fd(fd)
+{
+    symbols.assign(edge_len * edge_len, '.');
+    shown.assign(edge_len * edge_len, '.');
+    offsets.resize(edge_len * edge_len);
+    lines.resize(edge_len * edge_len);
+    columns.resize(edge_len * edge_len);
+    build_frame();
+}
+
+// the text of an empty board, recording where each hex's character goes
+void BoardRenderer::build_frame()
+{
+    text.clear();
+    int line = 1;
+    size_t line_start = 0;
+    auto new_line = [&] {
+        text += '\n';
+        line++;
+        line_start = text.size();
+    };
+
+    // number legend across the top of the board: each number ends above its column's hex
+    text += "  1";
+    for (int col = 2; col != edge_len + 1; ++col) {
+        text.append(max(1, 4 - n_digits(col)), ' ');
+        append_int(text, col);
+    }
+    new_line();
+
+    // format two lines for each row (except the last)
+    for (int row = 1; row != edge_len + 1; ++row) {
+        text.append(2 * row - n_digits(row) - 1, ' '); // the row number ends 2 spaces further right each row
+        append_int(text, row);
+        text += ' ';
+        for (int col = 1; col != edge_len + 1; ++col) {
+            int linear = (row - 1) * edge_len + (col - 1);
+            offsets[linear] = text.size();
+            lines[linear] = line;
+            columns[linear] = text.size() - line_start + 1;
+            text += symbols[linear];
+            if (col < edge_len)
+                text += spacer;
+        }
+        new_line();
+
+        // connector lines to show edges between board positions
+        if (row != edge_len) {
+            text.append(row * 2, ' ');
+            for (int col = 1; col != edge_len; ++col)
+                text += connector;
+            text += last_connector;
+            new_line();
+        }
+        else {
+            new_line(); // last row: no connector slashes
+            new_line();
+        }
+    }
+    n_lines = line - 1;
+}
+
+void BoardRenderer::draw()
+{
+    for (size_t i = 0; i < symbols.size(); i++)
+        text[offsets[i]] = symbols[i];
+
+    if (!cursor_updates) {
+        write_all(text);
+        return;
+    }
+
+    out.clear();
+    if (!on_screen) { // the whole board at the top of a clear screen
+        out += "\033[H\033[2J";
+        out += text;
+        on_screen = true;
+    }
+    else { // rewrite the hexes that changed and put the cursor back
+        out += "\0337";
+        for (size_t i = 0; i < symbols.size(); i++) {
+            if (symbols[i] == shown[i])
+                continue;
+            out += "\033[";
+            append_int(out, lines[i]);
+            out += ';';
+            append_int(out, columns[i]);
+            out += 'H';
+            out += symbols[i];
+        }
+        out += "\0338";
+    }
+    shown = symbols;
+    write_all(out);
+}
+
+void BoardRenderer::clear()
+{
+    if (cursor_updates && on_screen) { // keep the board: clear the lines below it
+        out.clear();
+        out += "\033[";
+        append_int(out, n_lines + 1);
+        out += ";1H\033[J";
+        write_all(out);
+    }
+    else
+        write_all("\033[2J");
+}
+
+// text already sent to cout goes first so the board lands in the right place
+void BoardRenderer::write_all(const string &s)
+{
+    cout.flush();
+    size_t done = 0;
+    while (done < s.size()) {
+        ssize_t n = ::write(fd, s.data() + done, s.size() - done);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return; // the terminal is gone: nothing useful to do
+        }
+        done += n;
+    }
+}
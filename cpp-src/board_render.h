@@ -0,0 +1,58 @@
+// ##########################################################################
+// #             Buffered terminal renderer for the ascii hexboard
+// ##########################################################################
+
+#ifndef BOARD_RENDER_H
+#define BOARD_RENDER_H
+
+/*
+The ascii board is the same text for every position except the one character
+of each hex. BoardRenderer builds that text (the frame) once per edge length,
+remembers where each hex's character sits in it and patches only those
+characters before writing the whole frame to the terminal with one write call.
+Drawing a board allocates nothing and flushes once, where printing it piece by
+piece with endl flushed every line.
+
+With cursor_updates the board is drawn once at the top of the screen and later
+draws move the cursor to each hex that changed and rewrite only that character,
+saving and restoring the cursor so the text below the board stays in place.
+clear() then clears the text below the board instead of the whole screen.
+This assumes the text below the board never scrolls it off the top of the
+screen; for boards taller than the terminal use the default full redraws.
+*/
+
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+class BoardRenderer {
+  public:
+    BoardRenderer(int edge_len, bool cursor_updates = false, int fd = STDOUT_FILENO);
+
+    void set(int linear, char symbol) { symbols[linear] = symbol; } // the character to draw at a hex
+    void draw();  // write the board with one write call
+    void clear(); // clear the screen, or only below the board with cursor_updates
+    const string &frame() const { return text; } // the board as last drawn
+
+    bool cursor_updates;
+
+  private:
+    int edge_len;
+    int fd;
+    string text;           // the whole board: legend, rows and connector lines
+    vector<int> offsets;   // by linear index: position of the hex's character in text
+    vector<int> lines;     // by linear index: terminal line of the hex counted from 1
+    vector<int> columns;   // by linear index: terminal column of the hex counted from 1
+    vector<char> symbols;  // characters to draw
+    vector<char> shown;    // characters on the screen for cursor_updates
+    int n_lines = 0;       // terminal lines used by the board
+    bool on_screen = false; // the full board is at the top of the screen
+    string out;            // escape sequences for cursor_updates, reused
+
+    void build_frame();
+    void write_all(const string &s);
+};
+
+#endif
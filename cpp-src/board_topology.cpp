@@ -0,0 +1,205 @@
+// ##########################################################################
+// #             Board topology shared by every Hex with the same edge length
+// ##########################################################################
+
+#include "board_topology.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "helpers.h"
+
+using namespace std;
+
+shared_ptr<const BoardTopology> BoardTopology::for_size(int edge_len)
+{
+    static mutex mtx;
+    static unordered_map<int, shared_ptr<const BoardTopology>> cache;
+
+    lock_guard<mutex> lock(mtx);
+    auto &topo = cache[edge_len];
+    if (!topo)
+        topo = make_shared<const BoardTopology>(edge_len);
+    return topo;
+}
+
+BoardTopology::BoardTopology(int edge_len)
+    : edge_len(edge_len), max_idx(edge_len * edge_len), graph(max_idx, 0)
+{
+    if (edge_len < 1)
+        throw invalid_argument("Bad size input. Must be odd, positive integer.");
+
+    define_borders();
+    if (edge_len > 1) // a single hex has no neighbors
+        define_edges();
+    define_bridges();
+    define_rings();
+    define_neighbor_table();
+    bitboard.setup(edge_len);
+    make_zobrist_keys();
+}
+
+// create vectors containing start and finish borders for both sides
+void BoardTopology::define_borders() // tested OK
+{
+    // yes--we could this all in one loop but, this is much more obvious
+
+    // initialize the inner vectors as empty. NOTE: the zero index for the outer
+    // vector should NEVER be used
+    for (int i = 0; i != 3; ++i) {
+        start_border.push_back(vector<int>{});
+        finish_border.push_back(vector<int>{});
+    }
+
+    // top border
+    for (int row = 1, col = 1; col < edge_len + 1; col++) {
+        start_border[1].push_back(rc2l(row, col));
+    }
+    // bottom border
+    for (int row = edge_len, col = 1; col < edge_len + 1; col++) {
+        finish_border[1].push_back(rc2l(row, col));
+    }
+    // left border
+    for (int row = 1, col = 1; row < edge_len + 1; row++) {
+        start_border[2].push_back(rc2l(row, col));
+    }
+    // right border
+    for (int row = 1, col = edge_len; row != edge_len + 1; ++row) {
+        finish_border[2].push_back(rc2l(row, col));
+    }
+}
+
+void BoardTopology::define_edges()
+{
+    // REMINDER!!!: row and col indices are treated as 1-based!
+
+    // add graph edges for adjacent hexes based on the layout of a Hex game
+    //    linear indices run from 0 at upper, left then across the row,
+    //    then down 1 row at the left edge, and across, etc.
+    // 
+    // 4 corners of the board: 2 or 3 edges per node                            
+    // upper left
+    graph.add_edge(rc2l(1, 1), rc2l(2, 1));
+    graph.add_edge(rc2l(1, 1), rc2l(1, 2));
+    // upper right
+    graph.add_edge(rc2l(1, edge_len), rc2l(1, (edge_len - 1)));
+    graph.add_edge(rc2l(1, edge_len), rc2l(2, edge_len));
+    graph.add_edge(rc2l(1, edge_len), rc2l(2, (edge_len - 1)));
+    // lower right
+    graph.add_edge(rc2l(edge_len, edge_len), rc2l(edge_len, (edge_len - 1)));
+    graph.add_edge(rc2l(edge_len, edge_len), rc2l((edge_len - 1), edge_len));
+    // lower left
+    graph.add_edge(rc2l(edge_len, 1), rc2l((edge_len - 1), 1));
+    graph.add_edge(rc2l(edge_len, 1), rc2l(edge_len, 2));
+    graph.add_edge(rc2l(edge_len, 1), rc2l((edge_len - 1), 2));
+
+    // 4 borders (excluding corners)  4 edges per node.
+    // north-south edges: constant row, vary col
+    for (int c = 2; c != edge_len; ++c) {
+        int r = 1;
+        graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
+        graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
+        graph.add_edge(rc2l(r, c), rc2l(r + 1, c - 1));
+        graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
+
+        r = edge_len;
+        graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
+        graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
+        graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
+        graph.add_edge(rc2l(r, c), rc2l(r - 1, c + 1));
+    }
+    // east-west edges: constant col, vary row
+    for (int r = 2; r != edge_len; ++r) {
+        int c = 1;
+        graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
+        graph.add_edge(rc2l(r, c), rc2l(r - 1, c + 1));
+        graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
+        graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
+
+        c = edge_len;
+        graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
+        graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
+        graph.add_edge(rc2l(r, c), rc2l(r + 1, c - 1));
+        graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
+    }
+
+    // interior tiles: 6 edges per hex
+    for (int r = 2; r != edge_len; ++r) {
+        for (int c = 2; c != edge_len; ++c) {
+            graph.add_edge(rc2l(r, c), rc2l(r - 1, c + 1));
+            graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
+            graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
+            graph.add_edge(rc2l(r, c), rc2l(r + 1, c - 1));
+            graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
+            graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
+        }
+    }
+}
+
+void BoardTopology::define_neighbor_table()
+{
+    neighbor_table.assign(6 * max_idx, -1);
+    for (int idx = 0; idx != max_idx; ++idx) {
+        int k = 0;
+        for (const auto &e : graph.get_neighbors(idx))
+            neighbor_table[6 * idx + k++] = e.to_node;
+    }
+}
+
+// for every pair of adjacent hexes c and d, find the two hexes a and b adjacent to both:
+// a and b are the ends of a two-bridge and c and d are the hexes that keep them connected
+void BoardTopology::define_bridges()
+{
+    bridges.assign(max_idx, vector<array<int, 3>>{});
+
+    for (int c = 0; c != max_idx; ++c) {
+        for (const auto &e_d : graph.get_neighbors(c)) {
+            int d = e_d.to_node;
+            vector<int> common;
+            for (const auto &e_c : graph.get_neighbors(c)) {
+                for (const auto &e : graph.get_neighbors(d)) {
+                    if (e.to_node == e_c.to_node)
+                        common.push_back(e.to_node);
+                }
+            }
+            if (common.size() == 2)
+                bridges[c].push_back(array<int, 3>{d, common[0], common[1]});
+        }
+    }
+}
+
+// neighbors of each hex in order around the hex: each one is adjacent to the next
+void BoardTopology::define_rings()
+{
+    const int dr[6] = {-1, -1, 0, 1, 1, 0};
+    const int dc[6] = {0, 1, 1, 0, -1, -1};
+
+    rings.assign(max_idx, array<int, 6>{});
+    for (int idx = 0; idx != max_idx; ++idx) {
+        for (int k = 0; k != 6; ++k) {
+            int r = idx / edge_len + 1 + dr[k];
+            int c = idx % edge_len + 1 + dc[k];
+            bool row_off = r < 1 || r > edge_len;
+            bool col_off = c < 1 || c > edge_len;
+            if (row_off && col_off)
+                rings[idx][k] = ring_corner;
+            else if (row_off)
+                rings[idx][k] = ring_x_border;
+            else if (col_off)
+                rings[idx][k] = ring_o_border;
+            else
+                rings[idx][k] = rc2l(r, c);
+        }
+    }
+}
+
+// keys are derived from the edge length only so every run and every machine
+// computes the same hash for a position: needed for the opening book file
+void BoardTopology::make_zobrist_keys()
+{
+    zobrist_base = splitmix64(0x4865780000000000ULL + edge_len) | 1;
+    zobrist.resize(2 * max_idx);
+    for (int i = 0; i != 2 * max_idx; ++i)
+        zobrist[i] = splitmix64(zobrist_base + i + 1);
+}
@@ -0,0 +1,76 @@
+// ##########################################################################
+// #             Definition/Declaration of Struct BoardTopology
+// ##########################################################################
+
+#ifndef BOARD_TOPOLOGY_H
+#define BOARD_TOPOLOGY_H
+
+/*
+Everything about the board that depends only on the edge length: the graph of adjacent
+hexes, the borders, the two-bridges, the rings of neighbors, the flat neighbor table,
+the bitmask masks and the Zobrist keys. None of it changes during a game, so it is built
+once per edge length and shared by every Hex of that size:
+    shared_ptr<const BoardTopology> topo = BoardTopology::for_size(11);
+for_size is thread-safe: the first caller for a size builds the topology and later
+callers get the same one. Topologies are kept until the program ends.
+
+Borders are indexed by the value of Hex::Marker: 1 for playerX, 2 for playerO. Index 0 is empty.
+*/
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "bitboard.h"
+#include "graph.h"
+
+using namespace std;
+
+// codes in rings for neighbors that are off the board
+const int ring_x_border = -1; // above the top row or below the bottom row
+const int ring_o_border = -2; // left of the first column or right of the last column
+const int ring_corner = -3;   // off the board in both directions: treated as open for both sides
+
+struct BoardTopology {
+    int edge_len;
+    int max_idx;
+
+    Graph<int> graph; // edges between adjacent hexes: the node data isn't used
+    vector<vector<int>> start_border; // indices to the top and left edges of the board
+    vector<vector<int>> finish_border; // indices to the bottom and right edges of the board
+
+    // two-bridges: two markers of one side with two empty hexes between them. For each hex c,
+    // bridges[c] holds {d, a, b} for every neighbor d of c where a and b are the two hexes
+    // adjacent to both c and d. If the opponent takes c, taking d keeps a and b connected.
+    vector<vector<array<int, 3>>> bridges;
+
+    // the 6 neighbors of each hex in order around the hex. Neighbors off the board are
+    // coded as the border they belong to: see cell_analysis.cpp
+    vector<array<int, 6>> rings;
+
+    // neighbors of each hex in a flat table: neighbor_table[6 * idx + k], -1 when there are fewer than 6
+    vector<int> neighbor_table;
+
+    HexBitboard bitboard; // border and column masks for simulated games as bitmasks
+
+    // Zobrist keys to hash board positions: one key per position for each player
+    uint64_t zobrist_base;    // hash of the empty board: never 0 so that 0 can mark an empty slot
+    vector<uint64_t> zobrist; // index is 2 * linear index + (0 for playerX, 1 for playerO)
+
+    explicit BoardTopology(int edge_len);
+
+    static shared_ptr<const BoardTopology> for_size(int edge_len);
+
+  private:
+    int rc2l(int row, int col) const { return (row - 1) * edge_len + (col - 1); } // 1-based, no checks
+
+    void define_borders();
+    void define_edges();
+    void define_bridges();
+    void define_rings();
+    void define_neighbor_table();
+    void make_zobrist_keys();
+};
+
+#endif
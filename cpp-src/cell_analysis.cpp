@@ -0,0 +1,112 @@
+// ##########################################################################
+// #             Class Hex methods to find dead and captured hexes
+// ##########################################################################
+
+/*
+Some empty hexes can't change who wins, whichever side gets them. monte_carlo_move
+doesn't need to evaluate them as candidate moves and the simulated games don't need to
+shuffle them, so we fill them in before simulating.
+
+The test looks at the 6 neighbors of an empty hex in order around the hex. For one side,
+each neighbor is a marker of that side (or that side's border), blocked (a marker or border of
+the other side) or open (empty). A marker of the side on the hex is useless if the hex can't be
+part of any minimal winning path for the side:
+  - the open and marker neighbors form at most one run around the ring, and
+  - every neighbor inside the run, except the 2 ends, is a marker of the side.
+Then any 2 neighbors a path could use to pass through the hex are already connected around it.
+
+If the hex is useless for the other side, the other side never needs it: it is captured by
+the side and we fill it with the side's marker. If it is useless for the side, we fill it with the
+other side's marker. A hex useless for both sides is dead. Either way who wins doesn't depend on
+the hex, so filling it leaves an equivalent position and we can repeat the test on the neighbors.
+*/
+
+#include "hex.h"
+
+using namespace std;
+
+bool Hex::is_useless_for(int idx, Marker side) const
+{
+    enum { blocked, open, own };
+    int state[6];
+    int n_blocked = 0;
+
+    for (int k = 0; k != 6; ++k) {
+        int nbr = rings[idx][k];
+        if (nbr >= 0) {
+            Marker m = get_hex_Marker(nbr);
+            state[k] = (m == side ? own : (m == Marker::empty ? open : blocked));
+        }
+        else if (nbr == ring_corner)
+            state[k] = open;
+        else {
+            Marker border = (nbr == ring_x_border ? Marker::playerX : Marker::playerO);
+            state[k] = (border == side ? own : blocked);
+        }
+        n_blocked += (state[k] == blocked);
+    }
+
+    if (n_blocked == 0) { // one run all the way around: any 2 neighbors can be the ends
+        for (int start = 0; start != 6; ++start) {
+            bool inside_own = true;
+            for (int k = 1; k != 5; ++k)
+                inside_own = inside_own && state[(start + k) % 6] == own;
+            if (inside_own)
+                return true;
+        }
+        return false;
+    }
+
+    // start after a blocked neighbor and walk once around the ring
+    int first_blocked = 0;
+    while (state[first_blocked] != blocked)
+        ++first_blocked;
+
+    int n_runs = 0;
+    int run_len = 0;
+    int inside_not_own = 0; // neighbors of the run that are not markers of the side, excluding the ends
+    for (int k = 1; k != 7; ++k) {
+        int s = state[(first_blocked + k) % 6];
+        if (s == blocked) {
+            if (run_len > 1 && state[(first_blocked + k - 1) % 6] != own)
+                --inside_not_own; // the last neighbor of the run is an end, not inside
+            run_len = 0;
+            continue;
+        }
+        if (run_len == 0)
+            ++n_runs; // the first neighbor of a run is an end, not inside
+        else if (s != own)
+            ++inside_not_own;
+        ++run_len;
+    }
+
+    return n_runs <= 1 && inside_not_own <= 0;
+}
+
+// fill in hexes that can't change the result until no more are found.
+// Returns the number of hexes filled. The hexes stay in empty_idxs so the caller can
+// restore the board with fill_board(empty_idxs, Marker::empty).
+int Hex::fill_inferior_cells(Marker side, Marker other_side)
+{
+    int n_filled = 0;
+    bool changed = true;
+
+    while (changed) {
+        changed = false;
+        for (auto idx : empty_idxs) {
+            if (!isblank(idx))
+                continue;
+            if (is_useless_for(idx, other_side)) {
+                set_hex_Marker(side, idx); // captured by side
+                changed = true;
+                ++n_filled;
+            }
+            else if (is_useless_for(idx, side)) {
+                set_hex_Marker(other_side, idx); // captured by other_side
+                changed = true;
+                ++n_filled;
+            }
+        }
+    }
+    return n_filled;
+}
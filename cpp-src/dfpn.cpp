@@ -0,0 +1,324 @@
+// ##########################################################################
+// #             Depth-first proof-number solver
+// ##########################################################################
+
+#include "dfpn.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+static Hex::Marker opponent(Hex::Marker side)
+{
+    return (side == Hex::Marker::playerX ? Hex::Marker::playerO : Hex::Marker::playerX);
+}
+
+DfpnSolver::DfpnSolver(size_t memory_mb) : locks(1024)
+{
+    size_t n_buckets = 1;
+    while (2 * n_buckets * bucket_size * sizeof(Entry) <= memory_mb * (size_t(1) << 20))
+        n_buckets *= 2;
+    table.resize(n_buckets * bucket_size);
+    bucket_mask = n_buckets - 1;
+    stats.tt_entries = table.size();
+
+    busy_mask = (1 << 16) - 1;
+    busy.reset(new atomic<uint16_t>[busy_mask + 1]);
+    for (size_t i = 0; i <= busy_mask; i++)
+        busy[i].store(0, memory_order_relaxed);
+}
+
+void DfpnSolver::clear()
+{
+    fill(table.begin(), table.end(), Entry{});
+}
+
+bool DfpnSolver::lookup(uint64_t key, Entry &entry)
+{
+    size_t bucket = key & bucket_mask;
+    lock_guard<mutex> guard(locks[bucket & (locks.size() - 1)]);
+    for (int i = 0; i < bucket_size; i++) {
+        const Entry &e = table[bucket * bucket_size + i];
+        if (e.key == key) {
+            entry = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+// always stores: the entry with the least work in a full bucket gives way
+void DfpnSolver::store(uint64_t key, uint32_t pn, uint32_t dn, int move, uint32_t work)
+{
+    size_t bucket = key & bucket_mask;
+    lock_guard<mutex> guard(locks[bucket & (locks.size() - 1)]);
+    Entry *victim = &table[bucket * bucket_size];
+    for (int i = 0; i < bucket_size; i++) {
+        Entry &e = table[bucket * bucket_size + i];
+        if (e.key == key) {
+            victim = &e;
+            work = max(work, e.work);
+            break;
+        }
+        if (e.work < victim->work)
+            victim = &e;
+    }
+    *victim = Entry{key, pn, dn, work, move};
+}
+
+void DfpnSolver::mid(Worker &w, Hex::Marker side, uint32_t th_pn, uint32_t th_dn, int ply)
+{
+    Hex &hb = *w.hb;
+    if ((++w.nodes & 1023) == 0 && time_limit > 0.0 && chrono::steady_clock::now() >= deadline)
+        stop = true;
+    if (stop)
+        return;
+
+    uint64_t key = hb.position_hash();
+    if (hb.shortest_distance(side) <= 1) {
+        store(key, 0, infinity, -1, 1);
+        return;
+    }
+
+    Hex::Marker other = opponent(side);
+    vector<int> &children = w.children[ply];
+    children.assign(hb.get_empty_idxs().begin(), hb.get_empty_idxs().end());
+    if (hb.shortest_distance(other) <= 1) { // only the moves that stop the opponent's connection
+        auto blocks = [&](int idx) {
+            hb.make_move(side, idx);
+            bool blocked = hb.shortest_distance(other) > 1;
+            hb.unmake_move();
+            return blocked;
+        };
+        children.erase(remove_if(children.begin(), children.end(), [&](int idx) { return !blocks(idx); }),
+                       children.end());
+        if (children.empty()) {
+            store(key, infinity, 0, -1, 1);
+            return;
+        }
+    }
+
+    long start_nodes = w.nodes;
+    uint32_t pn, dn;
+    int win_move = -1;
+    while (true) {
+        // pn = min of the children's dn, dn = sum of their pn. The child to expand has the smallest
+        // dn, raised by the threads already inside it so that the threads spread out.
+        pn = infinity;
+        dn = 0;
+        uint64_t best_pick = uint64_t(infinity) * 2, second_pick = best_pick;
+        int best = -1, min_child = -1;
+        uint32_t best_pn = 1, best_dn = 1, min_pn = 1;
+        for (int c : children) {
+            uint64_t child_key = key ^ hb.zobrist_key(side, c);
+            Entry e;
+            uint32_t c_pn = 1, c_dn = 1;
+            if (lookup(child_key, e)) {
+                c_pn = e.pn;
+                c_dn = e.dn;
+            }
+            if (c_dn == 0 && win_move < 0)
+                win_move = c;
+            if (c_dn < pn) {
+                pn = c_dn;
+                min_child = c;
+                min_pn = c_pn;
+            }
+            dn = (c_pn >= infinity || dn >= infinity ? infinity : min(dn + c_pn, infinity - 1));
+
+            uint64_t pick = c_dn + busy[child_key & busy_mask].load(memory_order_relaxed);
+            if (pick < best_pick) {
+                second_pick = best_pick;
+                best_pick = pick;
+                best = c;
+                best_pn = c_pn;
+                best_dn = c_dn;
+            }
+            else if (pick < second_pick)
+                second_pick = pick;
+        }
+        if (pn == 0 || dn == 0 || pn >= th_pn || dn >= th_dn || stop)
+            break;
+        if (best_dn >= th_pn) { // the busy counts picked a child that can't fit the thresholds
+            best = min_child;
+            best_pn = min_pn;
+            second_pick = pn + 1;
+        }
+
+        uint32_t child_th_pn = th_dn - dn + best_pn;
+        uint32_t child_th_dn = uint32_t(min<uint64_t>(th_pn, second_pick + second_pick / 4 + 1)); // 1 + epsilon
+
+        uint64_t child_key = key ^ hb.zobrist_key(side, best);
+        hb.make_move(side, best);
+        busy[child_key & busy_mask].fetch_add(1, memory_order_relaxed);
+        mid(w, other, child_th_pn, child_th_dn, ply + 1);
+        busy[child_key & busy_mask].fetch_sub(1, memory_order_relaxed);
+        hb.unmake_move();
+    }
+    store(key, pn, dn, win_move, uint32_t(min<long>(w.nodes - start_nodes + 1, infinity)));
+}
+
+// search from the worker's position until it is proven or disproven or the search stops
+void DfpnSolver::run_worker(Worker &w, Hex::Marker side)
+{
+    uint64_t key = w.hb->position_hash();
+    while (!stop) {
+        mid(w, side, infinity, infinity, 0);
+        Entry e;
+        if (lookup(key, e) && (e.pn == 0 || e.dn == 0))
+            break;
+    }
+    stop = true; // the other threads are done too
+}
+
+void DfpnSolver::setup_worker(Worker &w, const Hex &hb)
+{
+    int edge_len = hb.get_edge_len();
+    w.hb = make_unique<Hex>(edge_len);
+    w.hb->make_board();
+    w.hb->copy_position(hb);
+    w.children.resize(edge_len * edge_len + 1);
+    for (auto &c : w.children)
+        c.reserve(edge_len * edge_len);
+    w.nodes = 0;
+}
+
+int DfpnSolver::solve(Hex &hb, Hex::Marker side, int &move, WorkerPool *pool)
+{
+    auto start = chrono::steady_clock::now();
+    deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(time_limit));
+    stop = false;
+    stats.nodes = 0;
+
+    move = hb.winning_move(side);
+    if (move >= 0)
+        return 1;
+
+    int n_workers = (pool != nullptr ? pool->size() : 1);
+    vector<Worker> workers(n_workers);
+    auto job = [&](int i) {
+        setup_worker(workers[i], hb); // the worker's board is built on its own thread
+        run_worker(workers[i], side);
+    };
+    if (pool != nullptr)
+        pool->run(job);
+    else
+        job(0);
+
+    for (const Worker &w : workers)
+        stats.nodes += w.nodes;
+    stats.secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    Entry e;
+    if (!lookup(hb.position_hash(), e))
+        return 0;
+    move = e.move;
+    return (e.pn == 0 ? 1 : (e.dn == 0 ? -1 : 0));
+}
+
+// the result of the worker's position: from the table if it is there, else solved again
+int DfpnSolver::prove(Worker &w, Hex::Marker side, int &move)
+{
+    move = w.hb->winning_move(side);
+    if (move >= 0)
+        return 1;
+
+    uint64_t key = w.hb->position_hash();
+    Entry e;
+    if (!lookup(key, e) || (e.pn != 0 && e.dn != 0)) {
+        stop = false;
+        run_worker(w, side);
+        if (!lookup(key, e))
+            return 0;
+    }
+    move = e.move;
+    return (e.pn == 0 ? 1 : (e.dn == 0 ? -1 : 0));
+}
+
+// where the winner moves follow its winning move, where the loser moves follow every reply
+bool DfpnSolver::collect(Worker &w, Hex::Marker side, unordered_map<uint64_t, BookEntry> &found)
+{
+    Hex &hb = *w.hb;
+    bool rotated;
+    uint64_t key = hb.canonical_hash(rotated);
+    if (found.count(key) != 0)
+        return true;
+
+    int move;
+    int result = prove(w, side, move);
+    if (result == 0 || (result == 1 && move < 0))
+        return false; // out of time
+    if (time_limit > 0.0 && chrono::steady_clock::now() >= deadline)
+        return false;
+    found[key] = BookEntry{key, (result == 1 ? (rotated ? hb.rotate(move) : move) : -1), (result == 1 ? 1000 : 0)};
+
+    Hex::Marker other = opponent(side);
+    bool complete = true;
+    if (result == 1) {
+        hb.make_move(side, move);
+        if (hb.shortest_distance(side) != 0)
+            complete = collect(w, other, found);
+        hb.unmake_move();
+        return complete;
+    }
+
+    vector<int> replies(hb.get_empty_idxs().begin(), hb.get_empty_idxs().end());
+    for (int idx : replies) {
+        hb.make_move(side, idx);
+        complete = collect(w, other, found);
+        hb.unmake_move();
+        if (!complete)
+            break;
+    }
+    return complete;
+}
+
+size_t DfpnSolver::export_solutions(Hex &hb, Hex::Marker side, vector<BookEntry> &solutions)
+{
+    auto start = chrono::steady_clock::now();
+    deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(time_limit));
+
+    Worker w;
+    setup_worker(w, hb);
+    unordered_map<uint64_t, BookEntry> found;
+    if (!collect(w, side, found))
+        return 0;
+
+    solutions.clear();
+    for (const auto &kv : found)
+        solutions.push_back(kv.second);
+    return solutions.size();
+}
+
+int solve_board(int edge_len, int n_threads, size_t memory_mb, const string &filename)
+{
+    Hex hb(edge_len);
+    hb.make_board();
+    WorkerPool pool(n_threads);
+    DfpnSolver solver(memory_mb);
+
+    int move;
+    int result = solver.solve(hb, Hex::Marker::playerX, move, &pool);
+    const DfpnSolver::Stats &st = solver.get_stats();
+    cout << "Searched " << st.nodes << " positions in " << st.secs << " seconds on " << pool.size()
+         << " threads with a table of " << st.tt_entries << " positions" << endl;
+    if (result == 0) {
+        cout << "The " << edge_len << "x" << edge_len << " board was not solved" << endl;
+        return 0;
+    }
+    cout << "On the " << edge_len << "x" << edge_len << " board the first player "
+         << (result == 1 ? "wins" : "loses");
+    if (result == 1)
+        cout << " starting at " << hb.l2rc(move).row << "," << hb.l2rc(move).col;
+    cout << endl;
+
+    vector<BookEntry> solutions;
+    if (solver.export_solutions(hb, Hex::Marker::playerX, solutions) == 0) {
+        cout << "The proof could not be written out" << endl;
+        return result;
+    }
+    OpeningBook::write(filename, edge_len, edge_len * edge_len, 0, solutions);
+    cout << "Wrote " << solutions.size() << " solved positions to " << filename << endl;
+    return result;
+}
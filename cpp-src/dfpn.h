@@ -0,0 +1,117 @@
+// ##########################################################################
+// #             Definition/Declaration of Class DfpnSolver
+// ##########################################################################
+
+#ifndef DFPN_H
+#define DFPN_H
+
+/*
+Exact solver for small boards (up to about 6x6) by depth-first proof-number search.
+Every position is an OR node for the side to move: proof number pn is the least number
+of positions that must be proven to show the side to move wins, disproof number dn the
+least number to show it loses. For the side to move,
+    pn = min of the children's dn        dn = sum of the children's pn
+and the search always expands the child with the smallest dn until the node's numbers
+reach the thresholds its parent gave it (Nagai's MID with the 1 + epsilon trick).
+
+    the search runs on the Hex board itself with make_move and unmake_move
+    a side that needs only one more hex to connect wins at once (Hex::shortest_distance)
+    when the opponent needs only one more hex, only the moves that stop it are children
+    the transposition table is shared by every thread and its size is capped by memory_mb:
+        4 entry buckets replace the entry with the least work when full
+    threads: every worker of a WorkerPool searches from the root on its own board. A count
+        of the threads inside each position steers the others to different children.
+
+A proven result populates the solved position table: export_solutions walks the proof
+(the winning move where the winner moves, every reply where the loser moves) and writes
+it in the opening book's format (see opening_book.h): win_permille is 1000 for a proven win
+of the side to move with its winning move, 0 for a proven loss. The game loads the table
+into Hex::solved_positions; computer_move plays a solved win without simulating, and
+AlphaBeta scores solved positions without searching them.
+
+    hex solve size [n_threads] [memory_mb]    solves the empty board and writes the table
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+class DfpnSolver {
+  public:
+    struct Stats {
+        long nodes = 0;
+        double secs = 0.0;
+        size_t tt_entries = 0; // capacity of the transposition table
+    };
+
+    explicit DfpnSolver(size_t memory_mb = 256);
+
+    double time_limit = 0.0; // seconds per solve; 0 => until solved
+
+    // 1 side to move wins with move, -1 side to move loses, 0 out of time.
+    // With a pool, every worker searches the same position on its own board.
+    int solve(Hex &hb, Hex::Marker side, int &move, WorkerPool *pool = nullptr);
+
+    // entries of the proof of the position for the solved position table: 0 if out of time
+    size_t export_solutions(Hex &hb, Hex::Marker side, vector<BookEntry> &solutions);
+
+    const Stats &get_stats() const { return stats; }
+    void clear();
+
+  private:
+    static const uint32_t infinity = 1u << 30;
+    static const int bucket_size = 4;
+
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t pn = 1;
+        uint32_t dn = 1;
+        uint32_t work = 0; // nodes spent below the position: the replacement priority
+        int32_t move = -1; // winning move once proven
+    };
+
+    struct Worker {
+        unique_ptr<Hex> hb;
+        vector<vector<int>> children; // per ply
+        long nodes = 0;
+    };
+
+    vector<Entry> table;
+    size_t bucket_mask;
+    vector<mutex> locks; // striped by bucket
+    unique_ptr<atomic<uint16_t>[]> busy; // threads inside a position, indexed by hash
+    size_t busy_mask;
+
+    Stats stats;
+    atomic<bool> stop{false};
+    chrono::steady_clock::time_point deadline;
+
+    bool lookup(uint64_t key, Entry &entry);
+    void store(uint64_t key, uint32_t pn, uint32_t dn, int move, uint32_t work);
+    void mid(Worker &w, Hex::Marker side, uint32_t th_pn, uint32_t th_dn, int ply);
+    void run_worker(Worker &w, Hex::Marker side);
+    int prove(Worker &w, Hex::Marker side, int &move);
+    bool collect(Worker &w, Hex::Marker side, unordered_map<uint64_t, BookEntry> &found);
+    void setup_worker(Worker &w, const Hex &hb);
+};
+
+// default file name of the solved position table for a board size
+inline string solved_filename(int edge_len)
+{
+    return "Hex Solved " + to_string(edge_len) + "x" + to_string(edge_len) + ".bin";
+}
+
+// solve the empty board on n_threads (0 for all cpus) and write its solved position table:
+// returns 1 if the first player wins, -1 if it loses, 0 if unsolved
+int solve_board(int edge_len, int n_threads, size_t memory_mb, const string &filename);
+
+#endif
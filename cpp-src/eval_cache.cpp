@@ -0,0 +1,312 @@
+// ##########################################################################
+// #             Class EvalCache methods and the cached monte carlo move
+// ##########################################################################
+
+#include "eval_cache.h"
+#include "hex.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <sys/file.h>
+#include <unistd.h>
+
+using namespace std;
+
+const uint32_t cache_version = 1;
+
+namespace {
+
+// holds a flock on the lock file for the lifetime of the object
+class FileLock {
+  public:
+    FileLock(const string &lock_filename, int operation)
+    {
+        fd = ::open(lock_filename.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw runtime_error("Error opening lock file " + lock_filename + ".\n");
+        }
+        while (flock(fd, operation) != 0) {
+            if (errno != EINTR) {
+                ::close(fd);
+                throw runtime_error("Error locking " + lock_filename + ".\n");
+            }
+        }
+    }
+    ~FileLock()
+    {
+        flock(fd, LOCK_UN);
+        ::close(fd);
+    }
+
+  private:
+    int fd;
+};
+
+} // namespace
+
+EvalCache::EvalCache(const string &filename, int edge_len, size_t capacity)
+    : filename(filename), lock_filename(filename + ".lock"), edge_len(edge_len), n_cells(edge_len * edge_len),
+      capacity(capacity)
+{
+    FileLock lock(lock_filename, LOCK_SH);
+    reload();
+}
+
+EvalCache::~EvalCache()
+{
+    try {
+        flush();
+    }
+    catch (const exception &e) {
+        cerr << e.what(); // the counts are lost but the game is over anyway
+    }
+}
+
+bool EvalCache::reload()
+{
+    ifstream infile(filename, ios::in | ios::binary);
+    if (!(infile.is_open()))
+        return false; // no cache file yet
+
+    CacheHeader hdr;
+    if (!infile.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) || strncmp(hdr.magic, "HEXEVAL", 8) != 0
+        || hdr.version != cache_version || hdr.edge_len != uint32_t(edge_len)) {
+        return false; // unusable file: it will be replaced by the next save
+    }
+    if (hdr.generation == generation)
+        return true; // we already hold this version of the file
+
+    unordered_map<uint64_t, CacheEntry> loaded;
+    loaded.reserve(hdr.n_entries);
+    for (uint64_t i = 0; i != hdr.n_entries; ++i) {
+        uint64_t hash;
+        CacheEntry entry;
+        entry.wins.resize(n_cells);
+        entry.visits.resize(n_cells);
+        infile.read(reinterpret_cast<char *>(&hash), sizeof(hash));
+        infile.read(reinterpret_cast<char *>(&entry.last_used), sizeof(entry.last_used));
+        infile.read(reinterpret_cast<char *>(entry.wins.data()), n_cells * sizeof(uint32_t));
+        infile.read(reinterpret_cast<char *>(entry.visits.data()), n_cells * sizeof(uint32_t));
+        if (!infile)
+            return false; // truncated file: keep what we have
+        loaded.emplace(hash, move(entry));
+    }
+
+    entries.swap(loaded);
+    generation = hdr.generation;
+    clock = max(clock, hdr.clock);
+    add_pending();
+    return true;
+}
+
+void EvalCache::add_pending()
+{
+    // the uses keep their order but come after everything in the file
+    vector<pair<uint64_t, uint64_t>> order; // (last_used, hash)
+    order.reserve(pending.size());
+    for (const auto &p : pending)
+        order.emplace_back(p.second.last_used, p.first);
+    sort(order.begin(), order.end());
+
+    for (const auto &o : order) {
+        const CacheEntry &delta = pending[o.second];
+        bool counts = any_of(delta.visits.begin(), delta.visits.end(), [](uint32_t v) { return v > 0; });
+        if (!counts && entries.count(o.second) == 0)
+            continue; // a use of an entry another process has evicted since
+        CacheEntry &entry = entries[o.second];
+        if (entry.wins.empty()) {
+            entry.wins.assign(n_cells, 0);
+            entry.visits.assign(n_cells, 0);
+        }
+        for (int i = 0; i != n_cells; ++i) {
+            entry.wins[i] += delta.wins[i];
+            entry.visits[i] += delta.visits[i];
+        }
+        entry.last_used = ++clock;
+    }
+}
+
+void EvalCache::save()
+{
+    CacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "HEXEVAL", 8);
+    hdr.version = cache_version;
+    hdr.edge_len = edge_len;
+    hdr.n_entries = entries.size();
+    hdr.generation = ++generation;
+    hdr.clock = clock;
+
+    string tmp_filename = filename + ".tmp";
+    ofstream outfile(tmp_filename, ios::out | ios::binary | ios::trunc);
+    if (!(outfile.is_open())) {
+        throw runtime_error("Error opening file " + tmp_filename + ".\n");
+    }
+    outfile.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    for (const auto &p : entries) {
+        outfile.write(reinterpret_cast<const char *>(&p.first), sizeof(p.first));
+        outfile.write(reinterpret_cast<const char *>(&p.second.last_used), sizeof(p.second.last_used));
+        outfile.write(reinterpret_cast<const char *>(p.second.wins.data()), n_cells * sizeof(uint32_t));
+        outfile.write(reinterpret_cast<const char *>(p.second.visits.data()), n_cells * sizeof(uint32_t));
+    }
+    outfile.close();
+
+    // readers never see a partly written file
+    if (rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        throw runtime_error("Error replacing file " + filename + ".\n");
+    }
+}
+
+void EvalCache::evict()
+{
+    if (entries.size() <= capacity)
+        return;
+
+    // find the last_used value that leaves capacity entries
+    vector<uint64_t> ages;
+    ages.reserve(entries.size());
+    for (const auto &p : entries)
+        ages.push_back(p.second.last_used);
+    size_t n_drop = entries.size() - capacity;
+    nth_element(ages.begin(), ages.begin() + (n_drop - 1), ages.end());
+    uint64_t cutoff = ages[n_drop - 1];
+
+    for (auto it = entries.begin(); it != entries.end() && n_drop > 0;) {
+        if (it->second.last_used <= cutoff) {
+            it = entries.erase(it);
+            --n_drop;
+        }
+        else
+            ++it;
+    }
+}
+
+bool EvalCache::lookup(uint64_t hash, CacheEntry &entry)
+{
+    {
+        FileLock lock(lock_filename, LOCK_SH);
+        reload(); // pick up results written by other games
+    }
+    auto it = entries.find(hash);
+    if (it == entries.end())
+        return false;
+    entry = it->second;
+    return true;
+}
+
+void EvalCache::update(uint64_t hash, const vector<uint32_t> &wins, const vector<uint32_t> &visits)
+{
+    // the counts go both into the entries, for our own lookups, and into pending, for the next flush
+    for (auto *held : {&entries, &pending}) {
+        CacheEntry &entry = (*held)[hash];
+        if (entry.wins.empty()) {
+            entry.wins.assign(n_cells, 0);
+            entry.visits.assign(n_cells, 0);
+        }
+        for (int i = 0; i != n_cells; ++i) {
+            entry.wins[i] += wins[i];
+            entry.visits[i] += visits[i];
+        }
+    }
+    entries[hash].last_used = pending[hash].last_used = ++clock;
+
+    if (++n_updates >= flush_interval)
+        flush();
+}
+
+void EvalCache::touch(uint64_t hash)
+{
+    auto it = entries.find(hash);
+    if (it == entries.end())
+        return;
+    CacheEntry &used = pending[hash];
+    if (used.wins.empty()) {
+        used.wins.assign(n_cells, 0);
+        used.visits.assign(n_cells, 0);
+    }
+    it->second.last_used = used.last_used = ++clock;
+}
+
+void EvalCache::flush()
+{
+    n_updates = 0;
+    if (pending.empty())
+        return;
+
+    FileLock lock(lock_filename, LOCK_EX); // one writer at a time across all processes
+    reload(); // merge into the newest contents so no other writer's results are lost
+    pending.clear();
+
+    evict();
+    save();
+}
+
+/*
+Monte carlo move that starts from the cached counts for the position. If every candidate
+already has n_trials simulated games in the cache we don't simulate at all. Otherwise we
+simulate as usual and pool the new games with the cached ones to choose the move.
+The new counts are added to the cache for the next game that reaches this position; a full
+hit adds no counts but still marks the entry as recently used.
+*/
+Hex::RowCol Hex::cached_monte_carlo_move(Marker computer_marker, int n_trials, Marker person_marker)
+{
+    bool rotated;
+    uint64_t key = canonical_hash(rotated);
+    auto canon = [&](int idx) { return rotated ? rotate(idx) : idx; };
+
+    CacheEntry entry;
+    bool hit = eval_cache->lookup(key, entry);
+
+    vector<uint32_t> new_wins(max_idx, 0);
+    vector<uint32_t> new_visits(max_idx, 0);
+    bool simulated = false;
+
+    // moves that were pruned when the entry was made have no visits, so we
+    // only require the visited moves to have enough games
+    bool enough = hit;
+    bool any_visits = false;
+    for (int i = 0; enough && i != empty_idxs.size(); ++i) {
+        uint32_t v = entry.visits[canon(empty_idxs[i])];
+        enough = v == 0 || v >= uint32_t(n_trials);
+        any_visits = any_visits || v > 0;
+    }
+    enough = enough && any_visits;
+
+    if (!enough) {
+        const vector<int> &wins = evaluate_moves(computer_marker, n_trials, person_marker);
+        for (int i = 0; i != empty_idxs.size(); ++i) {
+            if (wins[i] < 0)
+                continue; // move not simulated: it can't change the result
+            new_wins[canon(empty_idxs[i])] = wins[i];
+            new_visits[canon(empty_idxs[i])] = n_trials;
+            simulated = true;
+        }
+    }
+
+    // choose the best pooled win rate
+    int best_move = empty_idxs[0];
+    double best_rate = -1.0;
+    for (auto idx : empty_idxs) {
+        int c = canon(idx);
+        double w = new_wins[c] + (hit ? entry.wins[c] : 0);
+        double v = new_visits[c] + (hit ? entry.visits[c] : 0);
+        double rate = v > 0 ? w / v : 0.0;
+        if (rate > best_rate) {
+            best_rate = rate;
+            best_move = idx;
+        }
+    }
+
+    if (simulated)
+        eval_cache->update(key, new_wins, new_visits);
+    else
+        eval_cache->touch(key);
+
+    return l2rc(best_move);
+}
@@ -0,0 +1,101 @@
+// ##########################################################################
+// #             Definition/Declaration of Class EvalCache
+// ##########################################################################
+
+#ifndef EVAL_CACHE_H
+#define EVAL_CACHE_H
+
+/*
+A persistent cache of simulation results shared by every game of one board size.
+The key is the canonical position hash (see Hex::canonical_hash) so a position and
+its 180 degree rotation share one entry. Each entry holds the wins and the number of
+simulated games (visits) for every candidate move, indexed by the linear index in the
+canonical orientation. New simulation results are added to the stored counts so
+repeated positions get better estimates instead of being simulated from scratch.
+
+The cache is bounded: when it is full the least recently used entries are evicted.
+A lookup that finds enough games counts as a use as well as an update does.
+Several game processes can share the file. New counts and uses are held in memory
+and written every flush_interval updates, when the game ends (flush) and by the
+destructor. A flush takes an exclusive flock on a separate lock file, merges the
+held counts into the newest file contents and replaces the file by renaming a
+temporary file, so the cost of rewriting the file is paid once for several moves.
+Readers take a shared lock.
+
+The game uses the cache only when the environment variable HEX_EVAL_CACHE is set:
+to a file name, or empty for the default file name of the board size.
+
+File layout:
+    CacheHeader
+    n_entries * { uint64 hash, uint64 last_used, uint32 wins[n_cells], uint32 visits[n_cells] }
+*/
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+struct CacheHeader {
+    char magic[8];         // "HEXEVAL"
+    uint32_t version;
+    uint32_t edge_len;
+    uint64_t n_entries;
+    uint64_t generation;   // incremented by every write: readers skip reloading an unchanged file
+    uint64_t clock;        // logical clock for least recently used eviction
+};
+
+struct CacheEntry {
+    uint64_t last_used = 0;
+    vector<uint32_t> wins;   // per canonical linear index
+    vector<uint32_t> visits; // per canonical linear index
+};
+
+class EvalCache {
+  public:
+    EvalCache(const string &filename, int edge_len, size_t capacity = 4096);
+    ~EvalCache();
+
+    // copy the entry for the canonical hash into entry: false if the position isn't cached
+    bool lookup(uint64_t hash, CacheEntry &entry);
+
+    // add new counts to the entry for the canonical hash. They are written by the next flush,
+    // which runs every flush_interval updates.
+    void update(uint64_t hash, const vector<uint32_t> &wins, const vector<uint32_t> &visits);
+
+    // mark the entry as recently used without new counts: written by the next flush
+    void touch(uint64_t hash);
+
+    // merge the held counts and uses into the file, evicting old entries if needed
+    void flush();
+
+    size_t size() const { return entries.size(); }
+
+    int flush_interval = 8; // updates held in memory before they are written
+
+  private:
+    string filename;
+    string lock_filename;
+    int edge_len;
+    int n_cells;
+    size_t capacity;
+    uint64_t generation = 0; // generation of the file contents held in entries
+    uint64_t clock = 0;
+    unordered_map<uint64_t, CacheEntry> entries;
+    unordered_map<uint64_t, CacheEntry> pending; // counts and uses not yet written: last_used orders the uses
+    int n_updates = 0; // updates since the last flush
+
+    bool reload(); // read the file if it changed since we last read it, keeping the pending counts
+    void add_pending(); // add the pending counts and uses to freshly loaded entries
+    void save();   // write all entries to a temporary file and rename it over the cache file
+    void evict();  // drop least recently used entries down to capacity
+};
+
+// default file name of the evaluation cache for a board size
+inline string cache_filename(int edge_len)
+{
+    return "Hex Eval Cache " + to_string(edge_len) + "x" + to_string(edge_len) + ".bin";
+}
+
+#endif
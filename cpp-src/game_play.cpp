@@ -4,8 +4,10 @@
 
 
 #include "hex.h"
+#include "alphabeta.h"
 #include "helpers.h"
 #include "timing.h"
+#include <optional>
 #include <stdexcept>
 #include <system_error>
 
@@ -13,65 +15,210 @@ using namespace std;
 
 void Hex::simulate_hexboard_positions(vector<int> &empties, Marker person_side, Marker computer_side) {
                                     // empties copy made by caller; this argument is a reference
-    shuffle(empties.begin(), empties.end(), rng);  // rng object uses clock based seed;  std::minstd_rand() starts the same
+    int n = empties.size();
+
+    // the order doesn't matter without bridge replies: give a random half to the person,
+    // who always gets placed first, and the rest to the computer
+    if (!bridge_playouts && balanced_split_playouts) {
+        int n_person = (n + 1) / 2;
+        rng.balanced_split(empties.data(), n, n_person);
+        for (int i = 0; i != n; ++i)
+            set_hex_Marker(i < n_person ? person_side : computer_side, empties[i]);
+        return;
+    }
+
+    rng.shuffle(empties);  // rng object uses clock based seed
 
     // swap the scalars each iteration to alternate markers
     Marker current = person_side; // human player always gets placed first
     Marker next = computer_side;
+
+    if (!bridge_playouts) {
+        for (int i = 0; i != n; ++i) {
+            set_hex_Marker(current, empties[i]);
+            swap(current, next);
+        }
+        return;
+    }
+
+    // bridge aware: a marker placed between the ends of the other side's two-bridge
+    // is answered in the other hex between them. The rest of the order stays random.
+    for (int i = 0; i != empties.size(); ++i) {
+        set_hex_Marker(Marker::empty, empties[i]); // clear the previous simulated game
+        order_pos[empties[i]] = i;
+    }
     for (int i = 0; i != empties.size(); ++i) {
-        set_hex_Marker(current, empties[i]);
+        int hex = empties[i];
+        set_hex_Marker(current, hex);
+        if (i + 1 != empties.size()) {
+            for (const auto &br : bridges[hex]) {
+                if (get_hex_Marker(br[1]) == next && get_hex_Marker(br[2]) == next && get_hex_Marker(br[0]) == Marker::empty) {
+                    int j = order_pos[br[0]]; // move the reply to the front of the rest of the order
+                    swap(empties[i + 1], empties[j]);
+                    order_pos[empties[j]] = j;
+                    order_pos[empties[i + 1]] = i + 1;
+                    break;
+                }
+            }
+        }
         swap(current, next);
     }
 }
 
-Hex::RowCol Hex::monte_carlo_move(Marker computer_marker, int n_trials, Marker person_marker)
+// simulate n_trials games for every empty position as a move by computer_marker
+// returns the wins for each candidate in the same order as empty_idxs. Moves that can't change
+// the result (see cell_analysis.cpp) are not simulated and get -1. The board is restored on return.
+const vector<int> &Hex::evaluate_moves(Marker computer_marker, int n_trials, Marker person_marker)
 {
+    if (pool != nullptr && pool->size() > 1)
+        return evaluate_moves_parallel(computer_marker, n_trials, person_marker);
+
+    // search scratch memory comes from the thread's arena: hand back what the last search used
+    ScratchArena &arena = ScratchArena::for_thread();
+    arena.reset();
+    PathScratch ps(arena.resource());
+    ps.visited.assign(max_idx, 0);
+    ps.neighbors.reserve(6);
+    path_scratch = &ps;
+
     // method uses class fields: clear them instead of creating new objects each time
-    shuffle_idxs.clear();
-    wins_per_move.clear();
+    wins_per_move.assign(empty_idxs.size(), -1);
+    live_idxs.clear();
 
     int wins = 0;
     Marker winning_side;
-    int best_move = 0;
 
-    int move_num = 0; // the index of empty hex positions that will be assigned the move to evaluate
+    // with virtual connections only the must-play moves can stop the opponent: see vc_engine.h.
+    // Found before the fill-in below puts markers on the board that nobody played.
+    if (vc_engine != nullptr)
+        find_must_play(computer_marker);
+
+    // dead and captured hexes keep their fill-in marker in every simulated game
+    if (prune_cells)
+        fill_inferior_cells(computer_marker, person_marker);
+    for (auto idx : empty_idxs) {
+        if (isblank(idx))
+            live_idxs.insert(idx);
+    }
+    if (live_idxs.empty()) { // the result is already decided: evaluate every move
+        fill_board(empty_idxs.dense(), Marker::empty);
+        for (auto idx : empty_idxs)
+            live_idxs.insert(idx);
+    }
+
+    if (!must_play.empty()) {
+        bool any_live = false;
+        for (auto move : live_idxs)
+            any_live = any_live || must_play.contains(move);
+        if (!any_live)
+            must_play.clear(); // all of them were filled in: simulate everything
+    }
+    if (vc_win >= 0 && isblank(vc_win))
+        wins_per_move[empty_idxs.index_of(vc_win)] = n_trials;
+
+    // on large boards only the moves with the lowest two-distance potentials are simulated: see large_board.cpp
+    if (max_candidates > 0 && must_play.empty() && candidates.empty())
+        find_candidates(computer_marker, live_idxs);
+    if (!candidates.empty()) {
+        bool any_live = false;
+        for (auto move : live_idxs)
+            any_live = any_live || candidates.contains(move);
+        if (!any_live)
+            candidates.clear(); // all of them were filled in: simulate everything
+    }
+
+    // in a position that is unchanged by 180 degree rotation, a move and its rotation are
+    // equally good: simulate only the one with the lower index and share its wins
+    bool symmetric = is_symmetric();
+    if (symmetric) { // a candidate's wins may be copied from its rotation: simulate that one too
+        for (int i = 0, n = candidates.size(); i != n; ++i) {
+            if (!candidates.contains(rotate(candidates[i])))
+                candidates.insert(rotate(candidates[i]));
+        }
+    }
+
+    // a move that connects wins every game: no need to simulate it. Checked before any
+    // simulated game leaves markers on the board.
+    if (distance_cutoff) {
+        for (auto move : live_idxs) {
+            if (!candidates.empty() && !candidates.contains(move))
+                continue; // not simulated either
+            set_hex_Marker(computer_marker, move);
+            if (shortest_distance(computer_marker) == 0)
+                wins_per_move[empty_idxs.index_of(move)] = n_trials;
+            set_hex_Marker(Marker::empty, move);
+        }
+    }
 
     // loop over the available move positions: make eval move, setup positions to randomize
-    for (move_num = 0; move_num != empty_idxs.size(); ++move_num) {
+    for (int move_num = 0; move_num != live_idxs.size(); ++move_num) {
+        int move = live_idxs[move_num];
+        if (symmetric && rotate(move) < move)
+            continue; // wins copied from the rotated move below
+        if (wins_per_move[empty_idxs.index_of(move)] >= 0)
+            continue; // the move connects
+        if (!must_play.empty() && !must_play.contains(move))
+            continue; // loses to the opponent's virtual connection
+        if (!candidates.empty() && !candidates.contains(move))
+            continue; // pruned: too far from both sides' best paths
 
         // make the computer's move to be evaluated
-        set_hex_Marker(computer_marker, empty_idxs[move_num]);
+        set_hex_Marker(computer_marker, move);
         wins = 0; // reset the win counter across the trials
 
-        // only on the first move, copy all the empty_idxs except 0 to the vector to be shuffled
-        if (move_num == 0) {
-            for (auto j = move_num; j != empty_idxs.size() - 1; ++j)  //every index but 0 opf empty_idxs copied into shuffle_idxs
-                shuffle_idxs.push_back(empty_idxs[j + 1]);
-        } else if (shuffle_idxs.size() < move_num) { // faster to simply change 2 values
-            shuffle_idxs[move_num - 1] = empty_idxs[move_num - 1]; // skip empty_idxs[move_num]
-            shuffle_idxs[move_num] = empty_idxs[move_num + 1];
-        } 
-        else {
-            shuffle_idxs[move_num - 1] = empty_idxs[move_num - 1];  // skip max index value of empty_idxs
+        // every live position except the move gets a marker in the simulated games
+        live_idxs.remove(move);
+        throw_away = live_idxs.dense();  // copy to pre-allocated vector;
+        live_idxs.undo_remove(move);
+
+        if (bitmask_playouts && !bridge_playouts) {
+            wins = simulate_bitmask(playout_batch, throw_away, move, computer_marker, n_trials);
+        }
+        else if (batch_playouts) {
+            wins = simulate_batch(playout_batch, throw_away, move, computer_marker, person_marker, n_trials);
         }
-        throw_away = shuffle_idxs;  // copy to pre-allocated vector;
-        for (int trial = 0; trial != n_trials; ++trial) {
-            simulate_hexboard_positions(throw_away, person_marker, computer_marker);  // callee uses reference to throw_away
+        else {
+            for (int trial = 0; trial != n_trials; ++trial) {
+                simulate_hexboard_positions(throw_away, person_marker, computer_marker);  // callee uses reference to throw_away
 
-            winning_side = find_ends(computer_marker, true);
+                winning_side = find_ends(computer_marker, true);
 
-            wins += (winning_side == computer_marker ? 1 : 0);
+                wins += (winning_side == computer_marker ? 1 : 0);
+            }
         }
 
         // calculate and save computer win percentage for this move
-        wins_per_move.push_back(wins);
+        wins_per_move[empty_idxs.index_of(move)] = wins;
 
         // reverse the trial move
-        set_hex_Marker(Marker::empty, empty_idxs[move_num]);
+        set_hex_Marker(Marker::empty, move);
     }
 
+    if (symmetric) {
+        for (auto move : live_idxs) {
+            if (rotate(move) < move)
+                wins_per_move[empty_idxs.index_of(move)] = wins_per_move[empty_idxs.index_of(rotate(move))];
+        }
+    }
+
+    // restore the board
+    fill_board(empty_idxs.dense(), Marker::empty);
+    path_scratch = nullptr; // ps goes out of scope
+    must_play.clear();      // good for this position only
+    candidates.clear();
+    vc_win = -1;
+
+    return wins_per_move;
+}
+
+Hex::RowCol Hex::monte_carlo_move(Marker computer_marker, int n_trials, Marker person_marker)
+{
+    int best_move = 0;
+
+    evaluate_moves(computer_marker, n_trials, person_marker);
+
     // find the maximum computer win percentage across all the candidate moves
-    int max = 0;
+    int max = -1; // any simulated move beats the moves that weren't simulated
     best_move = empty_idxs[0];
     for (int i = 0; i != wins_per_move.size(); ++i) { // linear search
         if (wins_per_move[i] > max) {
@@ -80,29 +227,80 @@ Hex::RowCol Hex::monte_carlo_move(Marker computer_marker, int n_trials, Marker p
         }
     }
 
-    // restore the board
-    fill_board(empty_idxs, Marker::empty);
-
     return l2rc(best_move);
 }
 
 void Hex::do_move(Marker side, RowCol rc)
 {
-    set_hex_Marker(side, rc);
+    make_move(side, rc2l(rc));
+}
+
+// make a move that can be taken back with unmake_move. move_history is the move stack.
+// Everything a move changes is restored in constant time, so searches can walk
+// through positions on this one board without copying it.
+void Hex::make_move(Marker side, int linear)
+{
+    set_hex_Marker(side, linear);
+    RowCol rc = l2rc(linear);
     move_history.emplace_back(side, rc.row, rc.col); // emplace a Move object
-    // remove empty
-    auto emptypos = find(empty_idxs.begin(), empty_idxs.end(), rc2l(rc));
-    auto foo = empty_idxs.erase(emptypos);  // we don't use foo but we have to catch the return value
-    
+    empty_idxs.remove(linear);
+    hash ^= zobrist_key(side, linear);
+    hash_rot ^= zobrist_key(side, rotate(linear));
+
     move_count++;
 }
 
+// take back the most recent move
+void Hex::unmake_move()
+{
+    if (move_history.empty()) {
+        throw logic_error("Error: no move to take back.\n");
+    }
+    const Move &mv = move_history.back();
+    int linear = rc2l(mv.row, mv.col);
+
+    hash ^= zobrist_key(mv.player, linear);
+    hash_rot ^= zobrist_key(mv.player, rotate(linear));
+    empty_idxs.undo_remove(linear);
+    set_hex_Marker(Marker::empty, linear);
+    move_history.pop_back();
+
+    move_count--;
+}
+
+// take back the person's most recent move and the computer's reply to it.
+// Returns false if the person hasn't moved yet.
+bool Hex::take_back_turn(Marker person_side)
+{
+    int n = move_history.size();
+    if (n < 2 || move_history[n - 2].player != person_side)
+        return false;
+    unmake_move(); // the computer's reply
+    unmake_move(); // the person's move
+    return true;
+}
+
 Hex::RowCol Hex::computer_move(Marker side, int n_trials, Marker person_marker)
 {
     RowCol rc;
     
     move_simulation_time.start();
-    rc = monte_carlo_move(side, n_trials, person_marker);
+    bool rotated;
+    uint64_t key = canonical_hash(rotated);
+    const BookEntry *solved = solved_positions.find(key); // a proven win beats the book
+    int book_move = (solved != nullptr && solved->win_permille == 1000 ? solved->move : opening_book.lookup(key));
+    if (book_move >= 0 && rotated)
+        book_move = rotate(book_move); // the book holds moves for the canonical orientation
+    if (book_move >= 0 && book_move < max_idx && isblank(book_move))
+        rc = l2rc(book_move); // solved position or opening book hit: no simulation needed
+    else if (alphabeta != nullptr)
+        rc = l2rc(alphabeta->best_move(*this, side));
+    else if (move_time_limit > 0.0)
+        rc = timed_monte_carlo_move(side, person_marker);
+    else if (eval_cache)
+        rc = cached_monte_carlo_move(side, n_trials, person_marker);
+    else
+        rc = monte_carlo_move(side, n_trials, person_marker);
     move_simulation_time.cum();
 
     do_move(side, rc);
@@ -138,11 +336,21 @@ Hex::RowCol Hex::person_move(Marker side)
         cout << "Enter a move in an empty position that contains '.'" << endl;
         cout << "Enter your move as the row number and the column number, separated by a space.\n";
         cout << "The computer prompts row col:  and you enter 3 5, followed by the enter key. ";
-        cout << "Enter -1 -1 to quit..." << endl;
+        cout << "Enter -2 -2 to take back your last move. Enter -1 -1 to quit..." << endl;
         cout << "row col: ";
 
         rc = move_input("Please enter 2 integers: ");
 
+        if (rc.row == -2) { // undo: take back the person's last move and the computer's reply
+            clear_display();
+            if (take_back_turn(side))
+                cout << "Your last move and the computer's reply were taken back.\n\n";
+            else
+                cout << "You have no move to take back.\n\n";
+            display_board();
+            continue;
+        }
+
         if (rc.row == -1) {
             rc.col = -1;
             return rc;
@@ -160,7 +368,10 @@ Hex::RowCol Hex::person_move(Marker side)
             if (!(outfile.is_open())) {
                 throw invalid_argument("Error opening file.");
             }
-            hex_graph.display_graph(outfile, true);
+            Graph<Marker> board_graph(max_idx, Marker::empty); // the shared graph with this game's markers
+            board_graph.graph = topology->graph.graph;
+            board_graph.node_data = positions;
+            board_graph.display_graph(outfile, true);
             outfile.close();
         }
 
@@ -208,18 +419,35 @@ bool Hex::is_valid_move(Hex::RowCol rc) const
 Hex::Marker Hex::find_ends(Hex::Marker side, bool whole_board = false)
 {
     int front = 0;
-    deque<int> possibles; // MUST BE A DEQUE! hold candidate sequences across the board
 
-    // method uses class fields neighbors and captured: clear them each time instead of creating new objects
+    // during a search the containers live on the thread's scratch arena for the whole search;
+    // otherwise make them here, still on the arena
+    optional<PathScratch> local_scratch;
+    if (path_scratch == nullptr)
+        local_scratch.emplace(ScratchArena::for_thread().resource());
+    PathScratch &ps = (path_scratch != nullptr ? *path_scratch : *local_scratch);
+
+    pmr::deque<int> &possibles = ps.possibles; // MUST BE A DEQUE! hold candidate sequences across the board
+    pmr::vector<int> &neighbors = ps.neighbors;
+    pmr::vector<int> &visited = ps.visited;
+
+    // clear them each time instead of creating new objects
+    possibles.clear();
     neighbors.clear();
-    captured.clear();
+    if (visited.size() != max_idx)
+        visited.assign(max_idx, 0);
+    int stamp = ++ps.stamp; // a hex is captured when visited holds this stamp
+    if (stamp == 0) { // the stamp wrapped around: reset the marks
+        fill(visited.begin(), visited.end(), 0);
+        stamp = ps.stamp = 1;
+    }
 
     // test for positions in the finish border, though start border would also work: assumption fewer Markers at the finish
     for (auto hex : finish_border[enum2int(side)]) { //look through the finish border
         if (get_hex_Marker(hex) == side) // if there is a Marker for this side, add it
         {
             possibles.push_back(hex); // we'll try to trace a path extending from each of these nodes
-            captured.push_back(hex); // it should never be added again
+            visited[hex] = stamp; // it should never be added again
         }
     }
 
@@ -233,7 +461,12 @@ Hex::Marker Hex::find_ends(Hex::Marker side, bool whole_board = false)
             }
 
             // find neighbors of the current node that match the current side and exclude already captured nodes
-            neighbors = hex_graph.get_neighbor_nodes(possibles[front], side, captured);
+            neighbors.clear();
+            const int *nbrs = &neighbor_table[6 * possibles[front]];
+            for (int k = 0; k != 6 && nbrs[k] >= 0; ++k) {
+                if (positions[nbrs[k]] == side && visited[nbrs[k]] != stamp)
+                    neighbors.push_back(nbrs[k]);
+            }
 
             if (neighbors.empty()) {
                 if (!possibles.empty()) // always have to do this before pop because c++ will terminate if you pop from empty
@@ -242,11 +475,11 @@ Hex::Marker Hex::find_ends(Hex::Marker side, bool whole_board = false)
             }
             else { // when we have one or more neighbors:
                 possibles[front] = neighbors[0]; // advance the endpoint to this neighbor, get rid of the previous possible
-                captured.push_back(neighbors[0]);
+                visited[neighbors[0]] = stamp;
 
                 for (int i = 1; i != neighbors.size(); ++i) { // if there is more than one neighbor..
                     possibles.push_back(neighbors[i]); // a new possible finishing end point
-                    captured.push_back(neighbors[i]);
+                    visited[neighbors[i]] = stamp;
                 }
             }
         } // while(true)
@@ -260,7 +493,7 @@ Hex::Marker Hex::find_ends(Hex::Marker side, bool whole_board = false)
         return Marker::empty; // no winner--too early in the game--no path from start to finish for this side
 }
 
-bool inline Hex::is_in_start(int idx, Marker side) const {
+bool Hex::is_in_start(int idx, Marker side) const {
     if (side == Marker::playerX) {
         return idx < edge_len;
     } else if (side == Marker::playerO) {
@@ -274,7 +507,7 @@ bool inline Hex::is_in_start(int idx, Marker side) const {
 Hex::Marker Hex::who_won() 
 {
     Marker winner = Marker::empty;
-    vector<Marker> sides{Marker::playerX, Marker::playerO};
+    const array<Marker, 2> sides{Marker::playerX, Marker::playerO};
 
     for (auto side : sides) {
         winner = find_ends(side);
@@ -332,7 +565,7 @@ void Hex::play_game(int n_trials)
     Marker computer_Marker;
     Marker winning_side;
 
-    clear_screen();
+    clear_display();
     cout << "\n\n";
 
     auto markers = who_goes_first();
@@ -353,11 +586,12 @@ void Hex::play_game(int n_trials)
 
             if (person_rc.row == -1) {
                 cout << "Game over! Come back again...\n";
-                exit(0);
+                winning_side = Marker::empty; // an abandoned game still goes to the batch analyzer
+                break;
             }
 
             computer_rc = computer_move(computer_Marker, n_trials, person_Marker);
-            clear_screen();
+            clear_display();
             cout << "Your move at " << person_rc << " was valid.\n";
             cout << "The computer moved at " << computer_rc << "\n\n\n";
             break;
@@ -373,16 +607,19 @@ void Hex::play_game(int n_trials)
             person_rc = person_move(person_Marker);
             if (person_rc.row == -1) {
                 cout << "Game over! Come back again...\n";
-                exit(0);
+                winning_side = Marker::empty; // an abandoned game still goes to the batch analyzer
+                break;
             }
 
-            clear_screen();
+            clear_display();
             cout << "Your move at " << person_rc << " was valid.\n";
 
             break;
         case Marker::empty:
             throw invalid_argument("Error: Player Marker for human player cannot be empty.\n");
         }
+        if (person_rc.row == -1)
+            break; // the person quit
 
         // test for a winner
         if (move_count >= (edge_len + edge_len - 1)) {
@@ -397,4 +634,8 @@ void Hex::play_game(int n_trials)
             }
         }
     }
+
+    save_game_record(game_log, winning_side);  // append to the log for batch analysis
+    if (eval_cache)
+        eval_cache->flush(); // write the simulation results held since the last flush
 }
@@ -0,0 +1,104 @@
+// ##########################################################################
+// #             Class Hex methods and functions for game records
+// ##########################################################################
+
+#include "game_record.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+char marker2char(Hex::Marker m)
+{
+    if (m == Hex::Marker::playerX)
+        return 'X';
+    else if (m == Hex::Marker::playerO)
+        return 'O';
+    else
+        return '.';
+}
+
+Hex::Marker char2marker(char c)
+{
+    if (c == 'X' || c == 'x')
+        return Hex::Marker::playerX;
+    else if (c == 'O' || c == 'o')
+        return Hex::Marker::playerO;
+    else
+        return Hex::Marker::empty;
+}
+
+// write the moves of the game so far in the game record format
+void Hex::write_game_record(ostream &out, Marker winner) const
+{
+    out << "size " << edge_len << "\n";
+    for (const auto &mv : move_history) {
+        out << "move " << marker2char(mv.player) << " " << mv.row << " " << mv.col << "\n";
+    }
+    if (winner == Marker::empty)
+        out << "winner none\n";
+    else
+        out << "winner " << marker2char(winner) << "\n";
+}
+
+// append the game record to a file so that one file collects many games
+void Hex::save_game_record(const string &filename, Marker winner) const
+{
+    ofstream outfile;
+    outfile.open(filename, ios::out | ios::app);
+    if (!(outfile.is_open())) {
+        throw invalid_argument("Error opening file.");
+    }
+    write_game_record(outfile, winner);
+    outfile.close();
+}
+
+// read all of the games in a game record file
+vector<GameRecord> load_game_records(const string &filename)
+{
+    ifstream infile;
+    infile.open(filename);
+    if (!(infile.is_open())) {
+        throw invalid_argument("Error opening file " + filename + ".\n");
+    }
+
+    vector<GameRecord> games;
+    string linestr, leader;
+    int line_num = 0;
+
+    while (getline(infile, linestr)) {
+        ++line_num;
+        stringstream ss{linestr};
+        if (!(ss >> leader) || leader[0] == '#')
+            continue; // blank line or comment
+
+        if (leader == "size") {
+            games.emplace_back();
+            ss >> games.back().edge_len;
+            games.back().source = filename + " #" + to_string(games.size());
+        }
+        else if (games.empty()) {
+            throw invalid_argument("Error in " + filename + " line " + to_string(line_num)
+                                   + ": a game must start with a size line.\n");
+        }
+        else if (leader == "move") {
+            string player;
+            int row = 0, col = 0;
+            ss >> player >> row >> col;
+            Hex::Marker m = char2marker(player.empty() ? ' ' : player[0]);
+            if (ss.fail() || m == Hex::Marker::empty) {
+                throw invalid_argument("Error in " + filename + " line " + to_string(line_num)
+                                       + ": bad move.\n");
+            }
+            games.back().moves.emplace_back(m, row, col);
+        }
+        else if (leader == "winner") {
+            string player;
+            ss >> player;
+            games.back().winner = char2marker(player.empty() ? ' ' : player[0]);
+        }
+    }
+    return games;
+}
@@ -0,0 +1,41 @@
+// ##########################################################################
+// #             Game records: save and load the moves of a game
+// ##########################################################################
+
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+/*
+A game record is a small text file in the same spirit as the graph file format
+read by Graph::load_graph_from_file. A file can hold many games: each "size" line
+starts a new game.
+
+    size 7          // edge length of the board
+    move X 4 4      // player, row, col using the 1-based row and col seen by the player
+    move O 3 5
+    ...
+    winner X        // optional: X, O or none
+
+Lines starting with # are comments.
+*/
+
+#include <string>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+struct GameRecord {
+    int edge_len = 0;
+    vector<Hex::Move> moves;
+    Hex::Marker winner = Hex::Marker::empty;
+    string source; // file name and game number, used in reports
+};
+
+vector<GameRecord> load_game_records(const string &filename);
+
+char marker2char(Hex::Marker m);
+Hex::Marker char2marker(char c);
+
+#endif
@@ -0,0 +1,279 @@
+// ##########################################################################
+// #             Hosting many games in one process
+// ##########################################################################
+
+#include "game_server.h"
+
+#include <chrono>
+
+using namespace std;
+
+GameServer::GameServer(int n_threads, ostream &out) : out(out)
+{
+    CpuTopology topology = CpuTopology::detect();
+    if (n_threads <= 0)
+        n_threads = topology.n_cpus();
+    vector<int> cpus = topology.worker_cpus(n_threads);
+
+    threads.reserve(n_threads);
+    for (int cpu : cpus)
+        threads.emplace_back(&GameServer::worker_loop, this, cpu);
+}
+
+GameServer::~GameServer()
+{
+    wait_idle();
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto &t : threads)
+        t.join();
+}
+
+// runs on the reading thread: only finds the game and queues the command
+bool GameServer::submit(const string &line)
+{
+    stringstream ss{line};
+    string cmd, name;
+    ss >> cmd >> name;
+
+    if (cmd.empty() || cmd[0] == '#')
+        return true;
+    if (cmd == "quit") {
+        quit_seen = true;
+        return false;
+    }
+
+    unique_lock<mutex> lock(mtx);
+    if (cmd == "list") {
+        size_t n = sessions.size();
+        lock.unlock();
+        reply("games " + to_string(n));
+        return true;
+    }
+    if (name.empty()) {
+        lock.unlock();
+        reply("error - missing game name in: " + line);
+        return true;
+    }
+
+    shared_ptr<Session> s;
+    auto it = sessions.find(name);
+    if (cmd == "new") {
+        if (it != sessions.end()) {
+            lock.unlock();
+            reply("error " + name + " game already exists");
+            return true;
+        }
+        s = make_shared<Session>();
+        s->name = name;
+        s->seed = splitmix64(chrono::system_clock::now().time_since_epoch().count() + ++n_created);
+        sessions[name] = s;
+    }
+    else {
+        if (it == sessions.end()) {
+            lock.unlock();
+            reply("error " + name + " no such game");
+            return true;
+        }
+        s = it->second;
+        if (cmd == "end")
+            sessions.erase(it); // the name is free for a new game right away
+    }
+
+    s->pending.push_back(line);
+    if (!s->scheduled) {
+        s->scheduled = true;
+        ready.push_back(s);
+        work_cv.notify_one();
+    }
+    return true;
+}
+
+void GameServer::wait_idle()
+{
+    unique_lock<mutex> lock(mtx);
+    idle_cv.wait(lock, [this] { return ready.empty() && n_busy == 0; });
+}
+
+int GameServer::serve(istream &in)
+{
+    string line;
+    while (getline(in, line)) {
+        if (!submit(line))
+            break;
+    }
+    wait_idle();
+    return 0;
+}
+
+// a pool thread: take a game with waiting commands and run them in order
+void GameServer::worker_loop(int cpu)
+{
+    pin_thread_to_cpu(cpu);
+
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        work_cv.wait(lock, [this] { return stopping || !ready.empty(); });
+        if (ready.empty()) // stopping
+            return;
+        shared_ptr<Session> s = ready.front();
+        ready.pop_front();
+        n_busy++;
+
+        while (!s->pending.empty()) {
+            string line = s->pending.front();
+            s->pending.pop_front();
+            lock.unlock();
+            try {
+                run_command(*s, line);
+            } catch (const exception &e) {
+                reply("error " + s->name + " " + e.what());
+            }
+            lock.lock();
+        }
+        s->scheduled = false;
+
+        n_busy--;
+        if (ready.empty() && n_busy == 0)
+            idle_cv.notify_all();
+    }
+}
+
+void GameServer::reply(const string &line)
+{
+    lock_guard<mutex> lock(out_mtx);
+    out << line << '\n';
+    out.flush();
+}
+
+string GameServer::board_string(const Hex &hb) const
+{
+    string result;
+    int n = hb.get_edge_len();
+    for (int row = 1; row <= n; row++) {
+        if (row > 1)
+            result += '/';
+        for (int col = 1; col <= n; col++) {
+            Hex::Marker m = hb.get_hex_Marker(row, col);
+            result += (m == Hex::Marker::playerX ? 'X' : m == Hex::Marker::playerO ? 'O' : '.');
+        }
+    }
+    return result;
+}
+
+// new <game> <size> [n_trials] [bridge|uniform|bitmask] [x|o]
+void GameServer::start_game(Session &s, stringstream &ss)
+{
+    int size = 0;
+    string playouts = "bridge", side = "x";
+    ss >> size;
+    if (!(ss >> s.n_trials))
+        s.n_trials = 1000;
+    ss >> playouts >> side;
+
+    if (size < 1 || size % 2 == 0 || s.n_trials < 1) {
+        reply("error " + s.name + " size must be an odd positive integer and n_trials positive");
+        s.over = true;
+        return;
+    }
+    if (playouts != "bridge" && playouts != "uniform" && playouts != "bitmask") {
+        reply("error " + s.name + " playouts must be bridge, uniform or bitmask");
+        s.over = true;
+        return;
+    }
+
+    s.hb.reset(new Hex(size));
+    s.hb->make_board();
+    s.hb->reseed(s.seed);
+    s.hb->bridge_playouts = (playouts == "bridge");
+    s.hb->bitmask_playouts = (playouts == "bitmask");
+    s.person = (side == "o" ? Hex::Marker::playerO : Hex::Marker::playerX);
+    s.computer = (side == "o" ? Hex::Marker::playerX : Hex::Marker::playerO);
+    reply("ok " + s.name);
+
+    if (s.computer == Hex::Marker::playerX) {
+        Hex::RowCol rc = s.hb->computer_move(s.computer, s.n_trials, s.person);
+        reply("move " + s.name + " " + to_string(rc.row) + " " + to_string(rc.col));
+    }
+}
+
+void GameServer::run_command(Session &s, const string &line)
+{
+    stringstream ss{line};
+    string cmd, name;
+    ss >> cmd >> name;
+
+    if (cmd == "new") {
+        start_game(s, ss);
+        return;
+    }
+    if (cmd == "end") {
+        s.hb.reset(); // the memory goes back now, not when the last reference goes away
+        reply("ok " + s.name);
+        return;
+    }
+    if (!s.hb) {
+        reply("error " + s.name + " game was not started");
+        return;
+    }
+    Hex &hb = *s.hb;
+
+    if (cmd == "board") {
+        reply("board " + s.name + " " + board_string(hb));
+    }
+    else if (cmd == "undo") {
+        const auto &history = hb.get_move_history();
+        bool taken_back = false;
+        if (!history.empty() && history.back().player == s.person) {
+            hb.unmake_move(); // the person's winning move: the computer never replied
+            taken_back = true;
+        }
+        else
+            taken_back = hb.take_back_turn(s.person);
+        if (taken_back) {
+            s.over = false;
+            reply("ok " + s.name);
+        }
+        else
+            reply("error " + s.name + " no move to take back");
+    }
+    else if (cmd == "play") {
+        Hex::RowCol rc;
+        if (!(ss >> rc.row >> rc.col)) {
+            reply("error " + s.name + " play needs a row and a col");
+            return;
+        }
+        if (s.over) {
+            reply("error " + s.name + " game is over");
+            return;
+        }
+        int n = hb.get_edge_len();
+        if (rc.row < 1 || rc.row > n || rc.col < 1 || rc.col > n || !hb.isblank(rc)) {
+            reply("error " + s.name + " illegal move " + to_string(rc.row) + " " + to_string(rc.col));
+            return;
+        }
+
+        hb.do_move(s.person, rc);
+        Hex::Marker winner = hb.who_won();
+        if (winner == Hex::Marker::empty) {
+            Hex::RowCol reply_rc = hb.computer_move(s.computer, s.n_trials, s.person);
+            reply("move " + s.name + " " + to_string(reply_rc.row) + " " + to_string(reply_rc.col));
+            winner = hb.who_won();
+        }
+        if (winner != Hex::Marker::empty) {
+            s.over = true;
+            reply("won " + s.name + " " + (winner == Hex::Marker::playerX ? "X" : "O"));
+        }
+    }
+    else
+        reply("error " + s.name + " unknown command " + cmd);
+}
+
+int run_server(int n_threads)
+{
+    GameServer server(n_threads);
+    return server.serve(cin);
+}
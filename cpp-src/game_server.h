@@ -0,0 +1,98 @@
+// ##########################################################################
+// #             Hosting many games in one process
+// ##########################################################################
+
+#ifndef GAME_SERVER_H
+#define GAME_SERVER_H
+
+/*
+Run as hex serve [n_threads] to host any number of games at once, driven by text lines
+on stdin. Every line names the game it is for; replies go to stdout, one line each,
+starting with the reply word and the game name. Replies for different games can come
+in any order, replies for one game come in the order of its commands.
+
+    new <game> <size> [n_trials] [bridge|uniform|bitmask] [x|o]
+                                 start a game: the person plays x (goes first, default) or o.
+                                 replies "ok <game>", then "move <game> row col" if the computer goes first
+    play <game> row col          the person's move: replies "move <game> row col" with the computer's move,
+                                 followed by "won <game> X|O" when either move wins
+    undo <game>                  take back the person's last move and the computer's reply, or only the
+                                 person's move if it won: "ok <game>"
+    board <game>                 "board <game> row/row/..." with . X O for each hex
+    end <game>                   forget the game: "ok <game>"
+    list                         "games <count>"
+    quit                         finish the commands already sent and exit (also at end of input)
+Errors are replied as "error <game> message".
+
+Games are independent Hex objects. The commands run on one pool of pinned threads
+(see worker_pool.h) shared by all games: a thread takes a game with waiting commands and
+runs them one at a time, so one game never runs on two threads at once, while many games
+simulate moves in parallel. Any front end that can write lines to a pipe, or a tool such
+as socat for a local socket, can drive the server.
+*/
+
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+class GameServer {
+  public:
+    explicit GameServer(int n_threads = 0, ostream &out = cout); // 0: one thread per allowed cpu
+    ~GameServer();
+    GameServer(const GameServer &) = delete;
+    GameServer &operator=(const GameServer &) = delete;
+
+    bool submit(const string &line); // queue one command: returns false after quit
+    void wait_idle();                // return when every queued command has run
+    int serve(istream &in);          // read commands until quit or end of input
+
+    bool stopped() const { return quit_seen; }
+
+  private:
+    struct Session {
+        string name;
+        unique_ptr<Hex> hb; // made by the first command, on a pool thread
+        Hex::Marker person = Hex::Marker::playerX;
+        Hex::Marker computer = Hex::Marker::playerO;
+        int n_trials = 1000;
+        unsigned seed = 0;
+        bool over = false;
+        deque<string> pending; // commands waiting to run
+        bool scheduled = false; // in the ready queue or running on a thread
+    };
+
+    ostream &out;
+    mutex out_mtx;
+
+    mutex mtx; // guards everything below
+    condition_variable work_cv;
+    condition_variable idle_cv;
+    unordered_map<string, shared_ptr<Session>> sessions;
+    deque<shared_ptr<Session>> ready;
+    int n_busy = 0;
+    bool stopping = false;
+    bool quit_seen = false;
+    unsigned long n_created = 0;
+    vector<thread> threads;
+
+    void worker_loop(int cpu);
+    void run_command(Session &s, const string &line);
+    void start_game(Session &s, stringstream &ss);
+    void reply(const string &line);
+    string board_string(const Hex &hb) const;
+};
+
+int run_server(int n_threads);
+
+#endif
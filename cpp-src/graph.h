@@ -28,6 +28,32 @@ struct Edge {
   Edge(int to_node = 0, int cost = 1) : to_node(to_node), cost(cost) {}
 };
 
+// distance of a node that can't be reached: large enough to add two of them without overflow
+const int path_blocked = 1 << 28;
+
+// scratch memory for the path evaluators of class Graph. Size it once with reset and pass the
+// same buffers to every call: the evaluators then never allocate. dist holds the result.
+struct PathBuffers {
+    vector<int> dist;   // distance of each node from the sources
+    vector<int> cur;    // bucket queue: nodes at the distance being finalized
+    vector<int> next;   // bucket queue: nodes at the next distance
+    vector<int> hits;   // two_distance: number of different finalized neighbors of each node
+    vector<int> stack;  // two_distance: own stones still to visit in a flood
+    vector<int> seen;   // two_distance: stamp of the last neighbor search that reached each node
+    int stamp = 0;
+
+    void reset(int n_nodes, int n_edges)
+    {
+        dist.assign(n_nodes, path_blocked);
+        cur.reserve(n_nodes + n_edges); // a node is queued at most once per edge into it
+        next.reserve(n_nodes + n_edges);
+        hits.assign(n_nodes, 0);
+        stack.reserve(n_nodes);
+        seen.assign(n_nodes, 0);
+        stamp = 0;
+    }
+};
+
 // output an Edge in an output stream
 inline ostream& operator<<(ostream &out, const Edge &e) {
   out << "  to: " << e.to_node << " cost: " << e.cost << endl;
@@ -60,7 +86,7 @@ class Graph {
         : size(size), node_data(size, node_elem), graph(size, vector<Edge>()) {}
     ~Graph() = default;
 
-    vector<T_data> node_data; // holds Data values of all nodes
+    vector<T_data, CacheAligned<T_data>> node_data; // holds Data values of all nodes: starts on a cache line
 
 //   private:
     // unordered_map<int, vector<Edge>> graph;
@@ -131,6 +157,109 @@ class Graph {
         return vec;
     }
 
+    // fill out with the neighbor_nodes that match the filter while excluding a set or vector or deque of nodes.
+    // out is cleared first: callers pass the same container every time so no temporary vectors are made
+    template <typename Container, typename Out>
+    void get_neighbor_nodes(const int current_node, const T_data data_filter, const Container &exclude, Out &out) const
+    {
+        out.clear();
+        for (const auto &e : graph[current_node]) {
+            if (node_data[e.to_node] == data_filter && !is_in(e.to_node, exclude))
+                out.push_back(e.to_node);
+        }
+    }
+
+    /*** zero_one_bfs
+        Shortest paths from a set of source nodes where the cost of a path is the cost of
+        the nodes it enters, read from cells (the node data of a board, or node_data):
+            own stone 0, empty 1, any other value blocks the node.
+        The source nodes cost the same to start on. Edge costs are not used.
+        Costs are only 0 or 1, so a bucket queue with 2 buckets replaces the heap of Dijkstra:
+        the nodes at distance d and the nodes at distance d + 1. Result in buf.dist.
+        For a Hex board with the sources on a player's start border, the smallest dist on the
+        finish border is the number of empty hexes the player still needs to connect.
+    */
+    template <typename Cell>
+    void zero_one_bfs(const vector<int> &sources, const Cell *cells, Cell own, Cell empty, PathBuffers &buf) const
+    {
+        fill(buf.dist.begin(), buf.dist.end(), path_blocked);
+        buf.cur.clear();
+        buf.next.clear();
+        for (int s : sources) {
+            int cost = (cells[s] == own ? 0 : (cells[s] == empty ? 1 : path_blocked));
+            if (cost < buf.dist[s]) {
+                buf.dist[s] = cost;
+                (cost == 0 ? buf.cur : buf.next).push_back(s);
+            }
+        }
+
+        for (int d = 0; !buf.cur.empty() || !buf.next.empty(); ++d) {
+            for (size_t i = 0; i != buf.cur.size(); ++i) { // cur grows while we go: own stones cost 0
+                int node = buf.cur[i];
+                if (buf.dist[node] != d)
+                    continue; // queued again with a smaller distance
+                for (const auto &e : graph[node]) {
+                    int to = e.to_node;
+                    if (cells[to] == own && d < buf.dist[to]) {
+                        buf.dist[to] = d;
+                        buf.cur.push_back(to);
+                    }
+                    else if (cells[to] == empty && d + 1 < buf.dist[to]) {
+                        buf.dist[to] = d + 1;
+                        buf.next.push_back(to);
+                    }
+                }
+            }
+            swap(buf.cur, buf.next);
+            buf.next.clear();
+        }
+    }
+
+    template <typename Cell>
+    void zero_one_bfs(const vector<int> &sources, Cell own, Cell empty, PathBuffers &buf) const
+    {
+        zero_one_bfs(sources, node_data.data(), own, empty, buf);
+    }
+
+    /*** two_distance
+        The Hex "two-distance" of every empty node from a border (the sources). The opponent
+        can always block the best way forward, so an empty node is only as close as its second
+        best neighbor: dist = 1 + the second smallest dist of its neighbors. Empty nodes on the
+        border are at distance 1. Own stones are transparent: the neighbors of a group of own
+        stones are neighbors of every node next to the group. Other values block.
+        Nodes are finalized in order of distance with the same 2 bucket queue as zero_one_bfs:
+        a node's distance is known as soon as a second different neighbor is finalized.
+        Own stones and blocked nodes are left at path_blocked. Result in buf.dist.
+    */
+    template <typename Cell>
+    void two_distance(const vector<int> &sources, const Cell *cells, Cell own, Cell empty, PathBuffers &buf) const
+    {
+        fill(buf.dist.begin(), buf.dist.end(), path_blocked);
+        fill(buf.hits.begin(), buf.hits.end(), 0);
+        buf.cur.clear();
+        buf.next.clear();
+
+        // the border itself is the first finalized "neighbor": its neighbors are at distance 1
+        empty_neighbors(sources, cells, own, empty, buf, [&](int y) {
+            buf.dist[y] = 1;
+            buf.cur.push_back(y);
+        });
+
+        for (int d = 1; !buf.cur.empty(); ++d) {
+            for (int node : buf.cur) {
+                empty_neighbors(graph[node], cells, own, empty, buf, [&](int y) {
+                    if (buf.dist[y] != path_blocked)
+                        return; // already finalized
+                    if (++buf.hits[y] == 2) {
+                        buf.dist[y] = d + 1;
+                        buf.next.push_back(y);
+                    }
+                });
+            }
+            swap(buf.cur, buf.next);
+            buf.next.clear();
+        }
+    }
 
     // with to_node and cost
     void add_edge(const int node, const int y, const int cost = 1)
@@ -159,6 +288,52 @@ class Graph {
         }
     }
 
+  private:
+    static int node_id(int node) { return node; }
+    static int node_id(const Edge &e) { return e.to_node; }
+
+    // call visit once for every empty node in nodes (node ids or the edges of a node) or next
+    // to a group of own stones that touches nodes. Used by two_distance to find the neighbors of
+    // a finalized node.
+    template <typename Nodes, typename Cell, typename Visit>
+    void empty_neighbors(const Nodes &nodes, const Cell *cells, Cell own, Cell empty, PathBuffers &buf,
+                         Visit visit) const
+    {
+        int stamp = ++buf.stamp;
+        buf.stack.clear();
+        for (const auto &n : nodes) {
+            int y = node_id(n);
+            if (buf.seen[y] == stamp)
+                continue;
+            if (cells[y] == empty) {
+                buf.seen[y] = stamp;
+                visit(y);
+            }
+            else if (cells[y] == own) {
+                buf.seen[y] = stamp;
+                buf.stack.push_back(y);
+            }
+        }
+        while (!buf.stack.empty()) { // flood the own groups
+            int g = buf.stack.back();
+            buf.stack.pop_back();
+            for (const auto &e : graph[g]) {
+                int y = e.to_node;
+                if (buf.seen[y] == stamp)
+                    continue;
+                if (cells[y] == empty) {
+                    buf.seen[y] = stamp;
+                    visit(y);
+                }
+                else if (cells[y] == own) {
+                    buf.seen[y] = stamp;
+                    buf.stack.push_back(y);
+                }
+            }
+        }
+    }
+
+  public:
     // note: we don't use this for the monte carlo simulation, but it's good for testing
     /*** load_graph_from_file
         Read a graph file to initialize a graph using the format of this example:
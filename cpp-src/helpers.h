@@ -10,10 +10,15 @@ Helper functions and overrides:
 String helpers
 
 an is_in function template for simple linear search of several types of small containers
+
+CacheAligned: allocator that starts a vector's storage on a cache line
 */
 
+#include <algorithm>
+#include <cstdint>
 #include <deque> // sequence of nodes in a path between start and destination
 #include <iostream>
+#include <new>
 #include <unordered_map> // container for definition of Graph
 #include <vector>
 
@@ -82,9 +87,38 @@ inline std::string tolower(const std::string &str)
 
 // other non-class functions
 
+// splitmix64: mixes a 64 bit value into a well distributed 64 bit value.
+// Used to make hash keys that are the same in every run and on every machine.
+inline uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// size of a cache line: per-thread data aligned to it never shares a line with another thread's data
+constexpr size_t cache_line_size = 64;
+
+// allocator for vectors whose storage must start on a cache line, like board copies used by one thread:
+//    vector<Marker, CacheAligned<Marker>> board;
+template <typename T> struct CacheAligned {
+    using value_type = T;
+
+    CacheAligned() = default;
+    template <typename U> CacheAligned(const CacheAligned<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(cache_line_size))); }
+    void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(cache_line_size)); }
+
+    template <typename U> bool operator==(const CacheAligned<U> &) const { return true; }
+    template <typename U> bool operator!=(const CacheAligned<U> &) const { return false; }
+};
+
 // test if value is in vector with trivial linear search for various primitive element types
-template <typename T>
-bool is_in(T val, vector<T> vec)
+// works for vectors with any allocator, including std::pmr::vector
+template <typename T, typename Alloc>
+bool is_in(T val, const vector<T, Alloc> &vec)
 {
     auto it = find(vec.cbegin(), vec.cend(), val);
     return it != vec.cend();
@@ -100,7 +134,7 @@ bool is_in(T val, const string &test_string)
 }
 
 // test if value is in deque with trivial linear search
-template <typename T> bool is_in(T val, deque<T> deq)
+template <typename T, typename Alloc> bool is_in(T val, const deque<T, Alloc> &deq)
 {
     auto it = find(deq.cbegin(), deq.cend(), val);
     return it != deq.cend();
@@ -2,15 +2,114 @@
     start playing the game:  this is the "main" for running the game
 
 
-    Run as hex [size] [n_trials]
+    Run as hex [size] [n_trials] [playouts] [n_threads] [display]
+           playouts is bridge (default), uniform or bitmask: how the computer simulates games
+           or alphabeta to search the game tree instead: n_trials is then the milliseconds per move
+           or timed to simulate for n_trials milliseconds per move, for large boards: see large_board.cpp
+           n_threads is the number of pinned worker threads that share the simulation: default 1, 0 for all cpus
+           display is redraw (default) to draw the whole board each move, or cursor to rewrite only the changed hexes
+           set HEX_EVAL_CACHE to a file name, or empty for the default, to keep simulation results: see eval_cache.h
+    or     hex analyze n_trials gamefile [gamefile ...]   to analyze stored game records
+    or     hex book size plies n_trials                   to build the opening book for a board size
+    or     hex serve [n_threads]                          to host many games driven by lines on stdin: see game_server.h
+    or     hex solve size [n_threads] [memory_mb]         to solve a small board exactly: see dfpn.h
+    or     hex net size [hidden ...]                      to write a randomly initialized network: see nn_eval.h
+    or     hex selfplay size n_games n_trials [n_threads] to record self-play games for training: see selfplay.h
 */
 
 #include "hex.h"
+#include "analysis.h"
+#include "game_server.h"
+#include "alphabeta.h"
+#include "dfpn.h"
+#include "vc_engine.h"
+#include "nn_eval.h"
+#include "selfplay.h"
 
 int main(int argc, char *argv[])
 {
     int size = 5;
     int n_trials = 1000;
+    string playouts = "bridge";
+    int n_threads = 1;
+    string display = "redraw";
+
+    if (argc >= 2 && string(argv[1]) == "analyze") {
+        if (argc < 4) {
+            cout << "Run as hex analyze n_trials gamefile [gamefile ...]. exiting..." << endl;
+            return 0;
+        }
+        AnalysisOptions opts;
+        opts.n_trials = atoi(argv[2]);
+        vector<string> filenames(argv + 3, argv + argc);
+        return run_analysis(filenames, opts);
+    }
+
+    if (argc >= 2 && string(argv[1]) == "serve") {
+        return run_server(argc >= 3 ? atoi(argv[2]) : 0);
+    }
+
+    if (argc >= 2 && string(argv[1]) == "solve") {
+        if (argc < 3 || argc > 5) {
+            cout << "Run as hex solve size [n_threads] [memory_mb]. exiting..." << endl;
+            return 0;
+        }
+        size = atoi(argv[2]);
+        if ((size < 0) or (size % 2 == 0))
+            throw invalid_argument("Bad size input. Must be odd, positive integer.");
+        int memory_mb = (argc >= 5 ? atoi(argv[4]) : 256);
+        solve_board(size, (argc >= 4 ? atoi(argv[3]) : 0), memory_mb, solved_filename(size));
+        return 0;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "net") {
+        if (argc < 3) {
+            cout << "Run as hex net size [hidden ...]. exiting..." << endl;
+            return 0;
+        }
+        size = atoi(argv[2]);
+        vector<int> hidden;
+        for (int i = 3; i < argc; i++)
+            hidden.push_back(atoi(argv[i]));
+        if (hidden.empty())
+            hidden = {256, 128};
+        NeuralNet net;
+        net.init_random(size, hidden, random_device{}());
+        net.write(net_filename(size));
+        cout << "Wrote an untrained network to " << net_filename(size) << endl;
+        return 0;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "selfplay") {
+        if (argc < 5 || argc > 6) {
+            cout << "Run as hex selfplay size n_games n_trials [n_threads]. exiting..." << endl;
+            return 0;
+        }
+        size = atoi(argv[2]);
+        if ((size < 0) or (size % 2 == 0))
+            throw invalid_argument("Bad size input. Must be odd, positive integer.");
+        Timing t;
+        t.start();
+        uint64_t n_records = run_selfplay(size, atoi(argv[3]), atoi(argv[4]), (argc == 6 ? atoi(argv[5]) : 0),
+                                          selfplay_filename(size));
+        t.cum();
+        cout << "Wrote " << n_records << " positions to " << selfplay_filename(size) << " in " << t.show()
+             << " seconds" << endl;
+        return 0;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "book") {
+        if (argc != 5) {
+            cout << "Run as hex book size plies n_trials. exiting..." << endl;
+            return 0;
+        }
+        size = atoi(argv[2]);
+        string filename = book_filename(size);
+        int n_positions = build_opening_book(size, atoi(argv[3]), atoi(argv[4]), filename);
+        cout << "Wrote " << n_positions << " positions to " << filename << endl;
+        return 0;
+    }
+
     if (argc == 1)
         ;  // run with defaults
     else if (argc == 2)
@@ -18,11 +117,37 @@ int main(int argc, char *argv[])
     else if (argc == 3) {
         size = atoi(argv[1]);
         n_trials = atoi(argv[2]);}
+    else if (argc == 4) {
+        size = atoi(argv[1]);
+        n_trials = atoi(argv[2]);
+        playouts = argv[3];}
+    else if (argc == 5) {
+        size = atoi(argv[1]);
+        n_trials = atoi(argv[2]);
+        playouts = argv[3];
+        n_threads = atoi(argv[4]);}
+    else if (argc == 6) {
+        size = atoi(argv[1]);
+        n_trials = atoi(argv[2]);
+        playouts = argv[3];
+        n_threads = atoi(argv[4]);
+        display = argv[5];}
     else {
         cout << "Wrong number of input arguments:\n"
-            << "Run as hex [size] [n_trials]. exiting..." << endl;
+            << "Run as hex [size] [n_trials] [bridge|uniform|bitmask|alphabeta|timed] [n_threads] [redraw|cursor]. exiting..." << endl;
         return 0;}
 
+    if (display != "redraw" && display != "cursor") {
+        cout << "Display must be redraw or cursor. exiting..." << endl;
+        return 0;
+    }
+
+    if (playouts != "bridge" && playouts != "uniform" && playouts != "bitmask" && playouts != "alphabeta" &&
+        playouts != "timed") {
+        cout << "Playouts must be bridge, uniform, bitmask, alphabeta or timed. exiting..." << endl;
+        return 0;
+    }
+
     if ((size < 0) or (size % 2 == 0)) {
         throw std::invalid_argument(
             "Bad size input. Must be odd, positive integer.");
@@ -30,6 +155,51 @@ int main(int argc, char *argv[])
 
     Hex hb(size);  // create the game object
     hb.make_board();
+    hb.bridge_playouts = (playouts == "bridge" || playouts == "timed");
+    hb.bitmask_playouts = (playouts == "bitmask");
+    hb.renderer->cursor_updates = (display == "cursor");
+    if (hb.opening_book.open(book_filename(size), size))
+        cout << "Using the opening book " << book_filename(size) << endl;
+    if (hb.solved_positions.open(solved_filename(size), size))
+        cout << "Using the solved positions " << solved_filename(size) << endl;
+    if (const char *cache_file = getenv("HEX_EVAL_CACHE")) { // share simulation results between game processes
+        string filename = (*cache_file != '\0' ? cache_file : cache_filename(size));
+        hb.eval_cache.reset(new EvalCache(filename, size));
+        cout << "Using the evaluation cache " << filename << endl;
+    }
+
+    unique_ptr<VcEngine> vcs;
+    if (size * size <= VcEngine::max_cells) { // virtual connections cut the moves to simulate
+        vcs.reset(new VcEngine(size));
+        hb.vc_engine = vcs.get();
+    }
+
+    unique_ptr<WorkerPool> pool;
+    if (n_threads != 1) {
+        pool.reset(new WorkerPool(n_threads));
+        hb.use_worker_pool(pool.get());
+        cout << "Simulating on " << pool->size() << " threads" << endl;
+    }
+
+    NeuralNet net;
+    if (net.load(net_filename(size), size)) {
+        hb.network = &net; // the tree search is one thread: no batching
+        cout << "Using the network " << net_filename(size) << (net.use_simd ? " (avx2)" : "") << endl;
+    }
+
+    AlphaBeta engine(hb.network != nullptr ? AlphaBeta::network_leaf : AlphaBeta::two_distance_leaf);
+    if (playouts == "alphabeta") {
+        engine.time_limit = n_trials / 1000.0;
+        engine.exact_limit = (size <= 5 ? size * size : 16); // solve outright once the board is this empty
+        hb.alphabeta = &engine;
+        cout << "Searching the game tree for " << n_trials << " ms per move" << endl;
+    }
+
+    if (playouts == "timed") {
+        hb.move_time_limit = n_trials / 1000.0;
+        hb.max_candidates = (size > 11 ? 2 * size : 0); // on large boards simulate only the most promising moves
+        cout << "Simulating for " << n_trials << " ms per move" << endl;
+    }
 
     hb.play_game(n_trials);
 
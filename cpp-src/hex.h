@@ -6,20 +6,37 @@
 #define HEX_H
 
 
+#include <algorithm>
+#include <array>
 #include <deque> // sequence of nodes in a path between start and destination
 #include <iostream>
+#include <memory>
+#include <memory_resource>
 #include <random>
 #include <stdlib.h> // for atoi()
 #include <string>
 #include <unordered_map> // container for definition of Graph
 #include <vector>
 
+#include "arena.h"
+#include "bitboard.h"
+#include "board_render.h"
+#include "board_topology.h"
+#include "eval_cache.h"
 #include "graph.h"
+#include "opening_book.h"
+#include "playout_rng.h"
+#include "sparse_matrix.h"
+#include "sparse_set.h"
 #include "timing.h"
+#include "worker_pool.h"
 #include "helpers.h"
 
 using namespace std;
 
+class AlphaBeta; // see alphabeta.h
+class VcEngine;  // see vc_engine.h
+class NnEvaluator; // see nn_eval.h
 
 
 // ##########################################################################
@@ -40,11 +57,13 @@ public:
             : row(row), col(col) {} // initialize to illegal position as sentinel
     };
 
-    enum class Marker {
+    enum class Marker : uint8_t {
         empty = 0,
         playerX = 1,
         playerO = 2
-    }; // for the data held at each board position
+    }; // for the data held at each board position: 1 byte so a 19x19 board is 361 bytes, not 1.4 KB
+
+    using Board = vector<Marker, CacheAligned<Marker>>; // storage for a board starts on a cache line
 
     struct Move {
         Marker player;
@@ -54,6 +73,49 @@ public:
         Move(Marker player, int row, int col): player(player), row(row), col(col) {}
     };   // used only for move_history
 
+    // find_ends memory, built on the thread's ScratchArena for the length of a search
+    struct PathScratch {
+        pmr::deque<int> possibles;
+        pmr::vector<int> neighbors;
+        pmr::vector<int> visited; // stamp of the last find_ends that captured each hex: O(1) test, no clearing
+        int stamp = 0;
+
+        explicit PathScratch(pmr::memory_resource *r) : possibles(r), neighbors(r), visited(r) {}
+    };
+
+    // scratch memory for simulating a batch of games at once: see playout_batch.cpp.
+    // Step i of every game in the batch is stored together: perms[i * batch_size + game],
+    // so filling the boards in lock-step reads the permutations in order.
+    struct PlayoutBatch {
+        int batch_size = 0;
+        vector<int> perms;       // the shuffled empty positions of every game, interleaved
+        Board boards;            // batch_size boards, one after the other, each on its own cache lines
+        size_t board_stride = 0; // max_idx rounded up to a whole number of cache lines
+        vector<int> winners;     // 1 if the computer won the game
+        vector<int> order;       // one game's order, used by bridge aware games
+        vector<int> order_pos;   // position of each hex in order
+        vector<int> stack;       // hexes to visit when tracing a path
+        vector<int> visited;     // stamp of the last path trace that reached each hex
+        int stamp = 0;
+        vector<uint64_t> bits;   // bitmasks for simulate_bitmask: 8 masks of HexBitboard::n_words words
+        PlayoutRng rng;
+
+        void set_storage(int batch, int max_idx, unsigned seed)
+        {
+            batch_size = batch;
+            perms.resize(size_t(batch) * max_idx);
+            board_stride = (max_idx + cache_line_size - 1) / cache_line_size * cache_line_size;
+            boards.resize(size_t(batch) * board_stride);
+            winners.resize(batch);
+            order.reserve(max_idx);
+            order_pos.resize(max_idx);
+            stack.reserve(max_idx);
+            visited.assign(max_idx, 0);
+            bits.assign(8 * ((max_idx + 63) / 64), 0);
+            rng.seed(seed);
+        }
+    };
+
 
     // constructor/destructor
     Hex(size_t size): edge_len(size) { // enforce input requirement and invariant
@@ -62,16 +124,15 @@ public:
                     "Bad size input. Must be odd, positive integer.");
             }
             max_idx = edge_len * edge_len;
-            empty_idxs.reserve(max_idx);
+            empty_idxs.reset(max_idx, true);  // add all positions-> all start empty
             throw_away.reserve(max_idx);
-            shuffle_idxs.reserve(max_idx);
             move_history.reserve(max_idx);
-            for (size_t i=0; i < max_idx; ++i) {
-                empty_idxs.emplace_back(i);  // add all positions-> all start empty
-            }
-            hex_graph = Graph<Marker>(max_idx, Marker::empty); // initializes all board positions to empty
+            positions.assign(max_idx, Marker::empty); // initializes all board positions to empty
+            hash = topology->zobrist_base;
+            hash_rot = topology->zobrist_base;
     }
-    // Hex::make_board() greats the graph of the board and the ascii display of the board
+    // Hex::make_board() sets up the memory for simulating games. The graph of the board
+    // is shared with every other Hex of the same size: see board_topology.h
 
     ~Hex() = default;
 
@@ -79,34 +140,87 @@ public:
 // members
 //
 public:
-    Graph<Marker> hex_graph;
-    // a member of Hex that is a Graph object, using "composition" instead
-    // of inheritance. The graph content is created by make_board().
-
     // for random shuffling of board moves
     unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::minstd_rand rng{seed}; // big difference in performance: std::mt19937 std::minstd_rand
+    PlayoutRng rng{seed}; // much cheaper shuffles than std::shuffle with std::minstd_rand: see playout_rng.h
 
     //   Timing winner_assess_time;   // measure cumulative time for assessing the game
     Timing move_simulation_time; // measure cumulative time for simulating moves
 
+    bool batch_playouts = true; // simulate games in batches on scratch boards: see playout_batch.cpp
+    bool prune_cells = true; // fill in dead and captured hexes before simulating: see cell_analysis.cpp
+    bool bitmask_playouts = false; // without bridge replies, simulate games as bitmasks: see playout_bitmask.cpp
+    bool balanced_split_playouts = true; // without bridge replies, draw a random half of the positions instead of a full order
+    bool bridge_playouts = true; // simulated games answer an intrusion into a two-bridge: see simulate_hexboard_positions
+    bool distance_cutoff = true; // a move that connects at once wins every game without simulating: see path_eval.cpp
+    int max_candidates = 0; // when > 0, evaluate_moves simulates only this many moves, chosen by two-distance: see large_board.cpp
+    double move_time_limit = 0.0; // seconds: when > 0, computer_move simulates until the time is up: see large_board.cpp
+
+    string game_log = "Hex Game Log.txt"; // games are appended here as game records, abandoned ones with winner none
+
+    OpeningBook opening_book; // precomputed computer moves for the first plies: see opening_book.h
+    OpeningBook solved_positions; // proven wins and losses from the dfpn solver in the book format: see dfpn.h
+    unique_ptr<EvalCache> eval_cache; // simulation results shared across games: see eval_cache.h
+    unique_ptr<BoardRenderer> renderer; // draws the board for display_board, made by make_board: see board_render.h
+
+    WorkerPool *pool = nullptr; // when set by use_worker_pool, evaluate_moves runs on the pool: see worker_pool.h
+    AlphaBeta *alphabeta = nullptr; // when set, computer_move searches the game tree instead of simulating: see alphabeta.h
+    VcEngine *vc_engine = nullptr; // when set, evaluate_moves simulates only the must-play moves: see vc_engine.h
+    NnEvaluator *network = nullptr; // learned move priors and position values for the tree search: see nn_eval.h
+
 private:
     const int edge_len;
     int max_idx; // maximum linear index
     int move_count{0}; // number of moves played during the game: each player's move adds 1
-    vector<vector<int>> start_border; // indices to the top and left edges of the board
-    vector<vector<int>> finish_border; // indices to the bottom and right edges of the board
-    vector<Marker> &positions = hex_graph.node_data; // positions ofMarkers on the board: alias to Graph
+
+    // the graph, borders, bridges and neighbor tables are built once per edge length and
+    // shared by every Hex of that size: the references below point into the topology
+    shared_ptr<const BoardTopology> topology = BoardTopology::for_size(edge_len);
+    const vector<vector<int>> &start_border = topology->start_border; // indices to the top and left edges of the board
+    const vector<vector<int>> &finish_border = topology->finish_border; // indices to the bottom and right edges of the board
+    const vector<vector<array<int, 3>>> &bridges = topology->bridges; // two-bridges around each hex
+    const vector<array<int, 6>> &rings = topology->rings; // neighbors in order around each hex
+    const vector<int> &neighbor_table = topology->neighbor_table; // neighbor_table[6 * idx + k]
+    const HexBitboard &bitboard = topology->bitboard; // border and column masks for simulated games as bitmasks
+    const vector<uint64_t> &zobrist = topology->zobrist; // Zobrist keys: index is 2 * linear index + side
+
+    Board positions; // positions of Markers on the board
     vector<Move> move_history;
 
     // used by monte_carlo_move: pre-allocated memory by method set_storage
-    vector<int> empty_idxs;   // empty positions for simulated moves
-    vector<int> shuffle_idxs; // copy of empty_idxs (except the candidate move)
+    SparseSet empty_idxs;     // empty positions: O(1) remove in do_move and undo
     vector<int> throw_away;   // the copy that gets shuffled
     vector<int> wins_per_move;
-    // used by find_ends: pre-allocated memory by method set_storage
-    vector<int> neighbors;
-    vector<int> captured;
+    vector<int> order_pos; // position of each hex in the shuffled order of a simulated game
+    SparseSet live_idxs;    // candidate moves left after filling in dead and captured hexes
+    SparseSet must_play;    // when not empty, the only moves worth simulating: see vc_engine.h
+    SparseSet candidates;   // when not empty, the only moves simulated: see large_board.cpp
+    vector<double> candidate_priors; // minus the two-distance potentials of each hex, for ranking candidates
+    vector<int> ranked;     // moves sorted by candidate_priors
+    int vc_win = -1;        // a move the virtual connections prove wins
+    PlayoutBatch playout_batch;
+
+    // used by evaluate_moves_parallel: one Hex per pool worker, created on the worker's thread
+    vector<unique_ptr<Hex>> workers;
+    vector<PaddedCounter> shared_wins; // wins of each candidate summed over the workers
+
+    // used by the path evaluators: see path_eval.cpp
+    PathBuffers path_buffers;
+    vector<int> td_start; // two-distance from the start border
+
+    // used by the resistance evaluator: see resistance.cpp
+    SparseMatrix conductance;          // pattern made by setup_conductance on first use
+    vector<double> cell_resistance;
+    vector<double> rhs;
+    array<vector<double>, 3> voltages; // last solution for each side, indexed by enum2int(side)
+    int cg_iterations = 0;             // iterations of the last solve
+
+    // used by find_ends: set by evaluate_moves for the length of the search
+    PathScratch *path_scratch = nullptr;
+
+    // Zobrist hashes of the position: the keys are in the topology
+    uint64_t hash;            // hash of the moves made so far: updated by make_move and unmake_move
+    uint64_t hash_rot;        // hash of the same moves rotated 180 degrees
 
   //
   // methods
@@ -119,27 +233,90 @@ private:
     public:
         void make_board();
         void display_board() const; // print the ascii board on screen
-    private:
-        string symdash(Marker val, bool last = false) const; // return hexboard Marker and add the spacer lines ___ needed to draw the board
-        string lead_space(int row) const; // how many spaces to indent each line of the hexboard?
-        void define_borders(); // create vectors containing start and finish
-                               // borders for both sides
+        void clear_display() const; // clear the screen before the next board
 
     // externally defined methods of class Hex in file game_play.cpp
     public:
         void play_game(int n_trials = 1000);
+        const vector<int> &evaluate_moves(Marker side, int n_trials, Marker other_side);
+        void do_move(Marker side, RowCol rc);
+        void make_move(Marker side, int linear);
+        void unmake_move();
+        bool take_back_turn(Marker person_side);
+        Marker who_won();
     private:
         void simulate_hexboard_positions(vector<int> &empties, Marker person_side, Marker computer_side);
         array<Marker, 2> who_goes_first();
         RowCol monte_carlo_move(Marker side, int n_trials, Marker person_side);
-        void do_move(Marker side, RowCol rc);
-        RowCol computer_move(Marker side, int n_trials, Marker other_side);
+    public:
+        RowCol computer_move(Marker side, int n_trials, Marker other_side); // choose a move and make it
+    private:
         RowCol move_input(const string &msg) const;
         RowCol person_move(Marker side);
         bool is_valid_move(RowCol rc) const;
         Marker find_ends(Marker side, bool whole_board);
-        Marker who_won();
-        bool inline is_in_start(int idx, Marker side) const;
+        bool is_in_start(int idx, Marker side) const;
+
+    // externally defined methods of class Hex in file cell_analysis.cpp
+    public:
+        int fill_inferior_cells(Marker side, Marker other_side);
+    private:
+        bool is_useless_for(int idx, Marker side) const;
+
+    // externally defined methods of class Hex in file playout_batch.cpp
+    public:
+        int simulate_batch(PlayoutBatch &pb, const vector<int> &empties, int move, Marker computer_side,
+                           Marker person_side, int n_trials) const;
+    private:
+        bool batch_board_winner(PlayoutBatch &pb, const Marker *board, Marker side) const;
+        void fill_bridge_aware(PlayoutBatch &pb, Marker *board, const vector<int> &empties, int game,
+                               Marker person_side, Marker computer_side) const;
+
+    // externally defined methods of class Hex in file playout_bitmask.cpp
+    public:
+        int simulate_bitmask(PlayoutBatch &pb, const vector<int> &empties, int move, Marker computer_side,
+                             int n_trials) const;
+
+    // externally defined methods of class Hex in file path_eval.cpp
+    public:
+        int shortest_distance(Marker side); // empty hexes side needs to connect: 0 if side has won
+        int winning_move(Marker side);      // a move that connects side at once or -1
+        int two_distance(Marker side);      // smallest two-distance potential of side's empty hexes
+        int static_eval(Marker side);       // > 0 is good for side: no simulation
+
+    // externally defined methods of class Hex in file resistance.cpp
+    public:
+        double resistance(Marker side);      // resistance of side's network from border to border
+        double resistance_eval(Marker side); // log(opponent's resistance / side's): > 0 is good for side
+        void resistance_priors(vector<double> &priors); // current through each empty hex
+        int get_cg_iterations() const { return cg_iterations; }
+    private:
+        void setup_conductance();
+
+    // externally defined methods of class Hex in file worker_pool.cpp
+    public:
+        void use_worker_pool(WorkerPool *worker_pool); // nullptr to search on this thread again
+        void copy_position(const Hex &from);
+    private:
+        const vector<int> &evaluate_moves_parallel(Marker side, int n_trials, Marker other_side);
+
+    // externally defined methods of class Hex in file vc_engine.cpp
+    private:
+        void find_must_play(Marker side);
+
+    // externally defined methods of class Hex in file large_board.cpp
+    private:
+        void find_candidates(Marker side, const SparseSet &moves);
+        RowCol timed_monte_carlo_move(Marker side, Marker person_side);
+
+    // externally defined methods of class Hex in file eval_cache.cpp
+    private:
+        RowCol cached_monte_carlo_move(Marker side, int n_trials, Marker person_side);
+
+    // externally defined methods of class Hex in file game_record.cpp
+    public:
+        void write_game_record(ostream &out, Marker winner) const;
+        void save_game_record(const string &filename, Marker winner) const;
 
     // setters and getters for the board
     private:
@@ -148,7 +325,8 @@ private:
         void set_hex_Marker(Marker val, int row, int col) { positions[rc2l(row, col)] = val; }
 
         void set_hex_Marker(Marker val, int linear) { positions[linear] = val; }
-        
+
+    public:
         Marker get_hex_Marker(RowCol rc) const { return positions[rc2l(rc)]; }
 
         Marker get_hex_Marker(int row, int col) const { return positions[rc2l(row, col)]; }
@@ -174,13 +352,30 @@ private:
             }
 
         void set_storage(int max_idx) { // optimization to reduce memory allocations for resizing containers
-            shuffle_idxs.reserve(max_idx);
             wins_per_move.reserve(max_idx);
-            captured.reserve(max_idx / 2 + 1);
-            neighbors.reserve(6);
+            order_pos.resize(max_idx);
+            live_idxs.reset(max_idx);
+            must_play.reset(max_idx);
+            candidates.reset(max_idx);
+            path_buffers.reset(max_idx, 6 * max_idx);
+            td_start.reserve(max_idx);
         }
 
 public:
+    // seed every random number generator: used when several Hex objects start at the same time
+    void reseed(unsigned new_seed)
+    {
+        seed = new_seed;
+        rng.seed(seed);
+        playout_batch.rng.seed(splitmix64(seed));
+    }
+
+    int get_edge_len() const { return edge_len; }
+
+    const vector<int> &get_empty_idxs() const { return empty_idxs.dense(); }
+
+    const vector<Move> &get_move_history() const { return move_history; }
+
     inline bool isblank(int linear) const {return get_hex_Marker(linear) == Marker::empty;}
 
     inline bool isblank(RowCol rc) const { return isblank(rc2l(rc)); }
@@ -252,10 +447,43 @@ public:
         return out;
     }
 
+    uint64_t zobrist_key(Marker side, int linear) const
+    {
+        return zobrist[2 * linear + (side == Marker::playerO ? 1 : 0)];
+    }
+
+    // hash of the current board position. The side to move is implied by the number of
+    // markers because playerX always moves first. Kept up to date by make_move and unmake_move,
+    // so it doesn't include trial markers set directly during a simulation.
+    uint64_t position_hash() const { return hash; }
+
+    // the board is symmetric under 180 degree rotation: each player's borders map onto
+    // themselves, so a rotated position is equally good for both players
+    int rotate(int linear) const { return max_idx - 1 - linear; }
+
+    bool is_symmetric() const
+    {
+        for (int i = 0, j = max_idx - 1; i < j; ++i, --j) {
+            if (positions[i] != positions[j])
+                return false;
+        }
+        return true;
+    }
+
+    // hash of the position or of its 180 degree rotation, whichever is smaller.
+    // rotated is set when the rotation gave the canonical hash, so callers can map
+    // their moves to the canonical orientation with rotate().
+    // This is the canonical form used by the opening book and the evaluation cache.
+    uint64_t canonical_hash(bool &rotated) const
+    {
+        rotated = hash_rot < hash;
+        return rotated ? hash_rot : hash;
+    }
+
     template <typename T> // cast enum class to int; works for different enum classes
-    int enum2int(T t) { return static_cast<int>(t); }
+    int enum2int(T t) const { return static_cast<int>(t); }
 
-    void fill_board(vector<int> indices, Marker value)
+    void fill_board(const vector<int> &indices, Marker value)
     {
         for (const auto idx : indices) {
             positions[idx] = value;
@@ -0,0 +1,355 @@
+/*
+    benchmark the computer's move search: the "main" for target hexbench
+
+    Run as hexbench [n_trials] [size ...]
+    or     hexbench large [ms] [size ...]   per-move latency of the timed search on large boards
+    or     hexbench check                   consistency checks: exits with 1 if one fails
+
+    For each board size and each way of simulating games, times evaluate_moves
+    after a couple of opening moves and counts the calls to operator new made
+    during the timed searches. After the warm-up search the scratch memory comes
+    from the thread's ScratchArena (see arena.h), so the count should be 0.
+    The "pool" rows run batch bridge playouts on a WorkerPool with one pinned thread per cpu.
+    After the simulations of each size, times the static evaluations that need no simulated
+    games (see path_eval.cpp and resistance.cpp) over a sequence of positions.
+    Last, times drawing the board to /dev/null with full redraws and with cursor updates (see board_render.h).
+
+    The large mode plays the computer against itself with move_time_limit = ms and the candidate
+    pruning of large_board.cpp, and reports the mean and worst time per move against that budget.
+
+    The check mode plays games with the virtual connection engine, cell pruning and take-backs,
+    comparing the engine kept up to date along the game with one built fresh from the moves.
+*/
+
+#include "hex.h"
+#include "alphabeta.h"
+#include "nn_eval.h"
+#include "vc_engine.h"
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iomanip>
+#include <new>
+
+// count every allocation made by the program
+static atomic<long> n_allocs{0};
+
+void *operator new(size_t bytes)
+{
+    n_allocs.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(bytes ? bytes : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void *operator new[](size_t bytes) { return operator new(bytes); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// aligned allocations: boards use CacheAligned (see helpers.h)
+void *operator new(size_t bytes, align_val_t al)
+{
+    n_allocs.fetch_add(1, memory_order_relaxed);
+    size_t align = static_cast<size_t>(al);
+    if (void *p = aligned_alloc(align, (bytes + align - 1) / align * align))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p, align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+
+struct Engine {
+    const char *name;
+    bool batch;
+    bool bitmask;
+    bool bridge;
+    bool pooled;
+};
+
+// play random moves and time static_eval and resistance_eval on each position
+void time_static_evals(int size)
+{
+    const int n_positions = 200;
+    Hex hb(size);
+    hb.make_board();
+    PlayoutRng rng(7);
+
+    Timing t_distance, t_resistance;
+    long cg_iterations = 0;
+    for (int i = 0; i < n_positions; i++) {
+        if (hb.get_empty_idxs().size() < 2 || hb.get_move_history().size() >= size * size / 2) {
+            while (!hb.get_move_history().empty())
+                hb.unmake_move();
+        }
+        const vector<int> &empties = hb.get_empty_idxs();
+        Hex::Marker side = (hb.get_move_history().size() % 2 == 0 ? Hex::Marker::playerX : Hex::Marker::playerO);
+        hb.make_move(side, empties[rng.bounded(empties.size())]);
+
+        t_distance.start();
+        hb.static_eval(Hex::Marker::playerX);
+        t_distance.cum();
+        t_resistance.start();
+        hb.resistance_eval(Hex::Marker::playerX);
+        t_resistance.cum();
+        cg_iterations += hb.get_cg_iterations();
+    }
+    cout << setw(5) << size << "  static evals: two-distance " << fixed << setprecision(1)
+         << t_distance.show() / n_positions * 1e6 << " us, resistance " << t_resistance.show() / n_positions * 1e6
+         << " us (" << double(cg_iterations) / n_positions << " cg iterations per solve)" << endl;
+}
+
+// node rate of a fixed depth alpha-beta search with each leaf evaluator, and an exact solve on small boards
+void time_alphabeta(int size)
+{
+    const int depth = 3;
+    const pair<const char *, AlphaBeta::LeafEval> leaves[] = {{"two-distance", AlphaBeta::two_distance_leaf},
+                                                                {"resistance", AlphaBeta::resistance_leaf}};
+    for (const auto &leaf : leaves) {
+        Hex hb(size);
+        hb.make_board();
+        hb.make_move(Hex::Marker::playerX, hb.rc2l(size / 2 + 1, size / 2 + 1));
+        hb.make_move(Hex::Marker::playerO, hb.rc2l(1, size));
+        AlphaBeta engine(leaf.second, 18);
+
+        Timing t;
+        t.start();
+        engine.search(hb, Hex::Marker::playerX, depth);
+        t.cum();
+        long nodes = engine.get_stats().nodes;
+        cout << setw(5) << size << "  alphabeta depth " << depth << " " << left << setw(13) << leaf.first << right
+             << setw(10) << nodes << " nodes" << fixed << setprecision(0) << setw(12) << nodes / t.show()
+             << " nodes/sec" << endl;
+    }
+
+    if (size > 5)
+        return;
+    Hex hb(size);
+    hb.make_board();
+    AlphaBeta engine;
+    engine.time_limit = 10.0; // half of it for the solve
+    engine.exact_limit = size * size;
+    int move = engine.best_move(hb, Hex::Marker::playerX);
+    const AlphaBeta::Stats &st = engine.get_stats();
+    cout << setw(5) << size << "  exact solve of the empty board: "
+         << (st.solved ? (st.score > 0 ? "first player wins" : "first player loses") : "not solved in time")
+         << " at " << hb.l2rc(move).row << "," << hb.l2rc(move).col << " in " << fixed << setprecision(3) << st.secs
+         << " secs, " << st.nodes << " nodes" << endl;
+}
+
+// network inference: one position at a time with and without avx2, then batches from 4 threads
+void time_network(int size)
+{
+    NeuralNet net;
+    net.init_random(size, {256, 128}, 1);
+    Hex hb(size);
+    hb.make_board();
+    hb.make_move(Hex::Marker::playerX, hb.rc2l(size / 2 + 1, size / 2 + 1));
+    NnOutput out;
+
+    const int n_evals = 200;
+    for (bool simd : {false, true}) {
+        if (simd && !NeuralNet::has_avx2())
+            continue;
+        net.use_simd = simd;
+        Timing t;
+        t.start();
+        for (int i = 0; i < n_evals; i++)
+            net.evaluate(hb, Hex::Marker::playerO, out);
+        t.cum();
+        cout << setw(5) << size << "  network " << (simd ? "avx2  " : "scalar") << " single " << fixed
+             << setprecision(1) << t.show() / n_evals * 1e6 << " us" << endl;
+    }
+
+    const int n_threads = 4;
+    NnBatcher batcher(net, n_threads);
+    Timing t;
+    t.start();
+    vector<thread> clients;
+    for (int c = 0; c < n_threads; c++) {
+        clients.emplace_back([&] {
+            NnOutput o;
+            for (int i = 0; i < n_evals; i++)
+                batcher.evaluate(hb, Hex::Marker::playerO, o);
+        });
+    }
+    for (auto &c : clients)
+        c.join();
+    t.cum();
+    NnBatcher::Stats st = batcher.get_stats();
+    cout << setw(5) << size << "  network batched from " << n_threads << " threads " << fixed << setprecision(1)
+         << st.n_requests / t.show() << " positions/sec, " << double(st.n_requests) / st.n_batches
+         << " per batch" << endl;
+}
+
+// time display_board over a game's worth of positions, one move per frame
+void time_display(int size)
+{
+    int fd = open("/dev/null", O_WRONLY);
+    for (bool cursor : {false, true}) {
+        Hex hb(size);
+        hb.make_board();
+        hb.renderer.reset(new BoardRenderer(size, cursor, fd));
+        hb.display_board(); // warm-up: the first cursor frame is a full draw
+
+        long allocs_before = n_allocs.load();
+        Timing t;
+        t.start();
+        int n_frames = 0;
+        for (int idx = 0; idx < size * size; idx += 3, n_frames++) {
+            hb.make_move(n_frames % 2 == 0 ? Hex::Marker::playerX : Hex::Marker::playerO, idx);
+            hb.display_board();
+        }
+        t.cum();
+        cout << setw(5) << size << "  display " << (cursor ? "cursor" : "redraw") << " " << fixed << setprecision(2)
+             << t.show() / n_frames * 1e6 << " us/frame, " << n_allocs.load() - allocs_before << " allocs" << endl;
+    }
+    close(fd);
+}
+
+// per-move latency of the timed search: every move should take about the budget, none much longer
+void time_large_boards(int ms, const vector<int> &sizes)
+{
+    const int n_moves = 8;
+    cout << setw(5) << "size" << setw(12) << "budget ms" << setw(10) << "mean ms" << setw(10) << "worst ms"
+         << "  within budget" << endl;
+    for (int size : sizes) {
+        Hex hb(size);
+        hb.make_board();
+        hb.reseed(42);
+        hb.move_time_limit = ms / 1000.0;
+        hb.max_candidates = 2 * size;
+
+        double total = 0.0, worst = 0.0;
+        Hex::Marker side = Hex::Marker::playerX, other = Hex::Marker::playerO;
+        for (int m = 0; m < n_moves; m++) {
+            Timing t;
+            t.start();
+            hb.computer_move(side, 0, other);
+            t.cum();
+            total += t.show();
+            worst = max(worst, t.show());
+            swap(side, other);
+        }
+        bool ok = worst <= 1.1 * ms / 1000.0; // a round can't be cut short: allow 10%
+        cout << setw(5) << size << setw(12) << ms << fixed << setprecision(0) << setw(10) << total / n_moves * 1000
+             << setw(10) << worst * 1000 << "  " << (ok ? "yes" : "no") << endl;
+    }
+}
+
+// the engine must see only the moves played: not the fill-in markers that evaluate_moves puts
+// on the board (see cell_analysis.cpp), before or after a take-back makes it start over
+bool check_vc_after_undo(int size, int n_games)
+{
+    int n_bad = 0;
+    for (int g = 0; g < n_games; g++) {
+        Hex hb(size);
+        hb.make_board();
+        hb.reseed(g + 1);
+        hb.prune_cells = true;
+        VcEngine vcs(size);
+        hb.vc_engine = &vcs;
+
+        Hex::Marker side = Hex::Marker::playerX, other = Hex::Marker::playerO;
+        for (int ply = 0; hb.who_won() == Hex::Marker::empty; ply++) {
+            hb.computer_move(side, 50, other);
+            swap(side, other);
+            if (ply % 3 == 2 && hb.take_back_turn(side)) // take back the last two moves: side is to move again
+                continue;
+
+            vcs.sync(hb); // incremental unless a take-back made it rebuild
+            const vector<Hex::Marker> &seen = vcs.get_board();
+            for (int idx = 0; idx < size * size; idx++)
+                n_bad += (seen[idx] != hb.get_hex_Marker(idx) ? 1 : 0);
+            vector<int> cells;
+            for (Hex::Marker s : {side, other}) {
+                vcs.must_play(s, cells);
+                for (int idx : cells)
+                    n_bad += (hb.get_hex_Marker(idx) != Hex::Marker::empty ? 1 : 0);
+            }
+        }
+    }
+    cout << setw(5) << size << "  vc engine after fill-in and take-backs: " << (n_bad == 0 ? "ok" : "FAILED") << endl;
+    return n_bad == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && string(argv[1]) == "check") {
+        bool ok = true;
+        for (int size : {5, 7, 9})
+            ok = check_vc_after_undo(size, 4) && ok;
+        return ok ? 0 : 1;
+    }
+
+    if (argc >= 2 && string(argv[1]) == "large") {
+        vector<int> large_sizes;
+        for (int i = 3; i < argc; i++)
+            large_sizes.push_back(atoi(argv[i]));
+        if (large_sizes.empty())
+            large_sizes = {19, 27, 37};
+        time_large_boards(argc >= 3 ? atoi(argv[2]) : 1000, large_sizes);
+        return 0;
+    }
+
+    int n_trials = 1000;
+    vector<int> sizes{5, 7, 9, 11};
+    if (argc >= 2)
+        n_trials = atoi(argv[1]);
+    if (argc >= 3)
+        sizes.assign(argc - 2, 0);
+    for (int i = 2; i < argc; i++)
+        sizes[i - 2] = atoi(argv[i]);
+
+    const Engine engines[] = {{"scalar uniform", false, false, false, false},
+                              {"scalar bridge", false, false, true, false},
+                              {"batch uniform", true, false, false, false},
+                              {"batch bridge", true, false, true, false},
+                              {"bitmask", false, true, false, false},
+                              {"pool bridge", true, false, true, true}};
+    const int n_reps = 3;
+    WorkerPool pool;
+
+    cout << setw(5) << "size" << "  " << left << setw(15) << "playouts" << right << setw(11) << "secs/move"
+         << setw(14) << "games/sec" << setw(10) << "allocs" << endl;
+    for (int size : sizes) {
+        for (const Engine &e : engines) {
+            Hex hb(size);
+            hb.make_board();
+            hb.reseed(42);
+            hb.batch_playouts = e.batch;
+            hb.bitmask_playouts = e.bitmask;
+            hb.bridge_playouts = e.bridge;
+            if (e.pooled)
+                hb.use_worker_pool(&pool);
+            hb.make_move(Hex::Marker::playerX, hb.rc2l(size / 2 + 1, size / 2 + 1));
+            hb.make_move(Hex::Marker::playerO, hb.rc2l(1, size));
+
+            hb.evaluate_moves(Hex::Marker::playerX, n_trials, Hex::Marker::playerO); // warm-up
+
+            long allocs_before = n_allocs.load();
+            Timing t;
+            t.start();
+            long n_games = 0;
+            for (int rep = 0; rep < n_reps; rep++) {
+                const vector<int> &wins = hb.evaluate_moves(Hex::Marker::playerX, n_trials, Hex::Marker::playerO);
+                for (int w : wins)
+                    n_games += (w >= 0 ? n_trials : 0);
+            }
+            t.cum();
+            long allocs = n_allocs.load() - allocs_before;
+
+            double secs = t.show() / n_reps;
+            cout << setw(5) << size << "  " << left << setw(15) << e.name << right << fixed << setprecision(4)
+                 << setw(11) << secs << setprecision(0) << setw(14) << n_games / t.show() << setw(10) << allocs
+                 << endl;
+        }
+        time_static_evals(size);
+        time_alphabeta(size);
+        time_network(size);
+        time_display(size);
+    }
+    return 0;
+}
@@ -20,188 +20,29 @@ Programmer: Lewis Levin Date: April 2023
 
 using namespace std;
 
-// some string constants used to draw the board
-const string connector = R"( \ /)";
-const string last_connector = R"( \)";
-
-// return hexboard Marker based on value and add the spacer lines ___ needed to draw the board
-string Hex::symdash(Marker val, bool last) const
-{
-    string symunit;
-    string dot = "."; // for Markers encoded as 0 == empty
-    string x = "X"; // for Markers encoded as 1
-    string o = "O"; // for Markers encoded as 2
-    string spacer = "___"; // part of drawing the board as ascii characters
-
-    if (last)
-        spacer = "";
-
-    if (val == Marker::empty)
-        symunit = dot + spacer;
-    else if (val == Marker::playerX)
-        symunit = x + spacer;
-    else if (val == Marker::playerO)
-        symunit = o + spacer;
-    else {
-        throw invalid_argument("Error: invalid hexboard value.");
-    }
-
-    return symunit;
-}
-
-// how many spaces to indent each line of the hexboard?
-string Hex::lead_space(int row) const { return string_by_n(" ", row * 2); }
-
-// create vectors containing start and finish borders for both sides
-void Hex::define_borders() // tested OK
+void Hex::make_board()
 {
-    // yes--we could this all in one loop but, this is much more obvious
-
-    // initialize the inner vectors as empty. NOTE: the zero index for the outer
-    // vector should NEVER be used
-    for (int i = 0; i != 3; ++i) {
-        start_border.push_back(vector<int>{});
-        finish_border.push_back(vector<int>{});
-    }
-
-    // top border
-    for (int row = 1, col = 1; col < edge_len + 1; col++) {
-        start_border[enum2int(Marker::playerX)].push_back(rc2l(row, col));
-    }
-    // bottom border
-    for (int row = edge_len, col = 1; col < edge_len + 1; col++) {
-        finish_border[enum2int(Marker::playerX)].push_back(rc2l(row, col));
-    }
-    // left border
-    for (int row = 1, col = 1; row < edge_len + 1; row++) {
-        start_border[enum2int(Marker::playerO)].push_back(rc2l(row, col));
-    }
-    // right border
-    for (int row = 1, col = edge_len; row != edge_len + 1; ++row) {
-        finish_border[enum2int(Marker::playerO)].push_back(rc2l(row, col));
-    }
-}
-
-void Hex::make_board() 
-{
-    // REMINDER!!!: row and col indices are treated as 1-based!
-
     // reserve storage
     set_storage(max_idx);
-
-    // define the board regions and move sequences
-    define_borders();
-
-    // add graph edges for adjacent hexes based on the layout of a Hex game
-    //    linear indices run from 0 at upper, left then across the row,
-    //    then down 1 row at the left edge, and across, etc.
-    // 
-    // 4 corners of the board: 2 or 3 edges per node                            
-    // upper left
-    hex_graph.add_edge(rc2l(1, 1), rc2l(2, 1));
-    hex_graph.add_edge(rc2l(1, 1), rc2l(1, 2));
-    // upper right
-    hex_graph.add_edge(rc2l(1, edge_len), rc2l(1, (edge_len - 1)));
-    hex_graph.add_edge(rc2l(1, edge_len), rc2l(2, edge_len));
-    hex_graph.add_edge(rc2l(1, edge_len), rc2l(2, (edge_len - 1)));
-    // lower right
-    hex_graph.add_edge(rc2l(edge_len, edge_len), rc2l(edge_len, (edge_len - 1)));
-    hex_graph.add_edge(rc2l(edge_len, edge_len), rc2l((edge_len - 1), edge_len));
-    // lower left
-    hex_graph.add_edge(rc2l(edge_len, 1), rc2l((edge_len - 1), 1));
-    hex_graph.add_edge(rc2l(edge_len, 1), rc2l(edge_len, 2));
-    hex_graph.add_edge(rc2l(edge_len, 1), rc2l((edge_len - 1), 2));
-
-    // 4 borders (excluding corners)  4 edges per node.
-    // north-south edges: constant row, vary col
-    for (int c = 2; c != edge_len; ++c) {
-        int r = 1;
-        hex_graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c - 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
-
-        r = edge_len;
-        hex_graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c + 1));
-    }
-    // east-west edges: constant col, vary row
-    for (int r = 2; r != edge_len; ++r) {
-        int c = 1;
-        hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c + 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
-
-        c = edge_len;
-        hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c - 1));
-        hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
-    }
-
-    // interior tiles: 6 edges per hex
-    for (int r = 2; r != edge_len; ++r) {
-        for (int c = 2; c != edge_len; ++c) {
-            hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c + 1));
-            hex_graph.add_edge(rc2l(r, c), rc2l(r, c + 1));
-            hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c));
-            hex_graph.add_edge(rc2l(r, c), rc2l(r + 1, c - 1));
-            hex_graph.add_edge(rc2l(r, c), rc2l(r, c - 1));
-            hex_graph.add_edge(rc2l(r, c), rc2l(r - 1, c));
-        }
-    }
+    playout_batch.set_storage(32, max_idx, seed);
+    renderer.reset(new BoardRenderer(edge_len));
 } // end of make_board
 
-
-// print the ascii board on screen
+// print the ascii board on screen: the renderer patches each hex into the board's text
 void Hex::display_board() const
 {
-    {
-        bool last; // last board value in the row: true or false?
-
-        // number legend across the top of the board
-        cout << "  " << 1;
-        for (int col = 2; col != edge_len + 1; ++col) {
-            if (col < 10) {
-                cout << "   ";
-                cout << col;
-            }
-            else {
-                cout << "  ";
-                cout << col;
-            }
-        }
-        cout << endl;
-        // format two lines for each row (except the last)
-        for (int row = 1; row != edge_len + 1; ++row) {
-            if (row < 10) {
-                cout << lead_space(row-1);
-                cout << row;
-                cout << " ";
-            }
-            else {
-                cout << lead_space(row - 2) << " ";
-                cout << row;
-                cout << " ";
-            }
-            for (int col = 1; col != edge_len + 1; ++col) {
-                last = col < edge_len ? false : true;
-                cout << symdash(get_hex_Marker(row, col), last); // add each column value
-            }
-
-            cout << endl; // line break for row
-
-            // connector lines to show edges between board positions
-            if (row != edge_len) {
-                cout << lead_space(row); // leading spaces for connector line
-                cout << string_by_n(connector, (edge_len - 1)) << last_connector << endl;
-            }
-            else {
-                cout << "\n\n"; // last row: no connector slashes
-            }
-        }
-    }
+    for (int linear = 0; linear < max_idx; linear++) {
+        Marker val = get_hex_Marker(linear);
+        if (val == Marker::empty)
+            renderer->set(linear, '.');
+        else if (val == Marker::playerX)
+            renderer->set(linear, 'X');
+        else if (val == Marker::playerO)
+            renderer->set(linear, 'O');
+        else
+            throw invalid_argument("Error: invalid hexboard value.");
+    }
+    renderer->draw();
 }
+
+void Hex::clear_display() const { renderer->clear(); }
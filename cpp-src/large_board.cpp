@@ -0,0 +1,119 @@
+// ##########################################################################
+// #             Class Hex methods for large boards: candidate pruning and timed search
+// ##########################################################################
+
+/*
+Simulating every empty hex costs about cells * n_trials * cells per move: fine on 11x11,
+minutes per move on 27x27 or 37x37. Two things keep large boards responsive:
+
+find_candidates     ranks the moves by their two-distance potentials (see path_eval.cpp) summed
+                    over both sides and keeps the max_candidates best, plus any move that
+                    connects either side at once. evaluate_moves then simulates only those, like
+                    the must-play moves of vc_engine.h. The other moves get -1. (The current
+                    through each hex, resistance_priors, piles up in the obtuse corners where the
+                    borders meet, so it makes a poor ranking on an open board.)
+timed_monte_carlo_move
+                    with move_time_limit set, computer_move spends a fixed time per move instead
+                    of a fixed number of games. Rounds of games per candidate run through
+                    evaluate_moves (so on the worker pool when there is one). The first round
+                    plays only first_round_trials games per candidate to measure how long a game
+                    takes; each later round plays as many games per move, up to round_trials, as
+                    fit in the time left, and none is started if fewer than first_round_trials
+                    fit. Once the moves have played round_trials games each, the better half go
+                    on to each next round, down to 2, which then share the rest of the time.
+*/
+
+#include "hex.h"
+
+#include <chrono>
+
+using namespace std;
+
+const int first_round_trials = 4; // games per candidate in the first round, which times a game
+const int round_trials = 32;      // most games per candidate in a later round
+
+// keep the max_candidates moves with the lowest two-distance potentials: the rest are not simulated
+void Hex::find_candidates(Marker side, const SparseSet &moves)
+{
+    candidates.clear();
+    if (moves.size() <= max_candidates)
+        return; // nothing to prune
+
+    // a hex's potential for a side is its two-distance from one border plus from the other:
+    // the hexes with the lowest potentials summed over both sides are on both sides' best paths
+    const Graph<int> &graph = topology->graph;
+    candidate_priors.assign(max_idx, 0.0);
+    for (Marker s : {Marker::playerX, Marker::playerO}) {
+        for (const auto *border : {&start_border[enum2int(s)], &finish_border[enum2int(s)]}) {
+            graph.two_distance(*border, positions.data(), s, Marker::empty, path_buffers);
+            for (int move : moves)
+                candidate_priors[move] -= min(path_buffers.dist[move], path_blocked);
+        }
+    }
+    ranked = moves.dense();
+    nth_element(ranked.begin(), ranked.begin() + max_candidates, ranked.end(),
+                [&](int a, int b) { return candidate_priors[a] > candidate_priors[b]; });
+    for (int i = 0; i != max_candidates; ++i)
+        candidates.insert(ranked[i]);
+
+    // a move that connects either side at once must be looked at whatever its potential
+    Marker other_side = (side == Marker::playerX ? Marker::playerO : Marker::playerX);
+    for (Marker s : {side, other_side}) {
+        if (shortest_distance(s) != 1)
+            continue;
+        for (int move : moves) {
+            set_hex_Marker(s, move);
+            bool connects = shortest_distance(s) == 0;
+            set_hex_Marker(Marker::empty, move);
+            if (connects && !candidates.contains(move))
+                candidates.insert(move);
+        }
+    }
+}
+
+Hex::RowCol Hex::timed_monte_carlo_move(Marker computer_marker, Marker person_marker)
+{
+    auto start = chrono::steady_clock::now();
+    auto elapsed = [&] { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+    vector<long> total_wins(empty_idxs.size(), 0); // by index in empty_idxs, which stays put
+    vector<int> alive; // indexes of the moves still in the running, best first after each round
+    candidates.clear();
+    int trials = first_round_trials;
+    int games_each = 0; // games played by each move still in the running
+
+    while (true) {
+        double round_start = elapsed();
+        const vector<int> &wins = evaluate_moves(computer_marker, trials, person_marker);
+        if (alive.empty()) { // the first round: every move that was simulated
+            for (int i = 0; i != wins.size(); ++i) {
+                if (wins[i] >= 0)
+                    alive.push_back(i);
+            }
+            if (alive.empty()) // nothing worth simulating: any move will do
+                return l2rc(empty_idxs[0]);
+        }
+        for (int i : alive)
+            total_wins[i] += max(wins[i], 0);
+        games_each += trials;
+        double secs_per_game = (elapsed() - round_start) / (double(alive.size()) * trials);
+
+        // every move left has played the same number of games: rank by wins, keep the better half
+        stable_sort(alive.begin(), alive.end(), [&](int a, int b) { return total_wins[a] > total_wins[b]; });
+        if (alive.size() > 2 && games_each >= round_trials)
+            alive.resize(max(2, int(alive.size() + 1) / 2));
+        if (alive.size() == 1)
+            break;
+
+        // as many games per move as fit in the time left
+        double games_left = (move_time_limit - elapsed()) / (secs_per_game * alive.size());
+        if (games_left < first_round_trials)
+            break;
+        trials = int(min(games_left, double(round_trials)));
+
+        for (int i : alive)
+            candidates.insert(empty_idxs[i]); // evaluate_moves simulates only these and clears them
+    }
+
+    return l2rc(empty_idxs[alive[0]]);
+}
@@ -0,0 +1,360 @@
+// ##########################################################################
+// #             Policy/value network inference on the cpu
+// ##########################################################################
+
+#include "nn_eval.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <immintrin.h>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+const uint32_t net_version = 1;
+
+static int round8(int n) { return (n + 7) & ~7; }
+
+bool NeuralNet::has_avx2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+}
+
+// ##########################################################################
+// #             dense layer kernels: y = relu(W x + bias) for a batch of x
+// ##########################################################################
+
+static void dense_scalar(const float *w, const float *bias, int n_out, int in_stride, const float *x,
+                         int batch, float *y, int y_stride, bool relu)
+{
+    for (int o = 0; o < n_out; o++) {
+        const float *row = w + size_t(o) * in_stride;
+        for (int b = 0; b < batch; b++) {
+            const float *xb = x + size_t(b) * in_stride;
+            float acc = bias[o];
+            for (int i = 0; i < in_stride; i++)
+                acc += row[i] * xb[i];
+            y[size_t(b) * y_stride + o] = (relu && acc < 0.0f ? 0.0f : acc);
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,fma"))) static inline float hsum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+// each weight row is loaded once for 4 positions of the batch
+__attribute__((target("avx2,fma"))) static void dense_avx2(const float *w, const float *bias, int n_out,
+                                                           int in_stride, const float *x, int batch, float *y,
+                                                           int y_stride, bool relu)
+{
+    for (int o = 0; o < n_out; o++) {
+        const float *row = w + size_t(o) * in_stride;
+        int b = 0;
+        for (; b + 4 <= batch; b += 4) {
+            const float *x0 = x + size_t(b) * in_stride;
+            const float *x1 = x0 + in_stride, *x2 = x1 + in_stride, *x3 = x2 + in_stride;
+            __m256 a0 = _mm256_setzero_ps(), a1 = _mm256_setzero_ps();
+            __m256 a2 = _mm256_setzero_ps(), a3 = _mm256_setzero_ps();
+            for (int i = 0; i < in_stride; i += 8) {
+                __m256 wv = _mm256_loadu_ps(row + i);
+                a0 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x0 + i), a0);
+                a1 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x1 + i), a1);
+                a2 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x2 + i), a2);
+                a3 = _mm256_fmadd_ps(wv, _mm256_loadu_ps(x3 + i), a3);
+            }
+            float acc[4] = {hsum(a0), hsum(a1), hsum(a2), hsum(a3)};
+            for (int k = 0; k < 4; k++) {
+                float v = acc[k] + bias[o];
+                y[size_t(b + k) * y_stride + o] = (relu && v < 0.0f ? 0.0f : v);
+            }
+        }
+        for (; b < batch; b++) {
+            const float *xb = x + size_t(b) * in_stride;
+            __m256 a = _mm256_setzero_ps();
+            for (int i = 0; i < in_stride; i += 8)
+                a = _mm256_fmadd_ps(_mm256_loadu_ps(row + i), _mm256_loadu_ps(xb + i), a);
+            float v = hsum(a) + bias[o];
+            y[size_t(b) * y_stride + o] = (relu && v < 0.0f ? 0.0f : v);
+        }
+    }
+}
+#endif
+
+void NeuralNet::dense(const Layer &layer, const float *x, int batch, float *y, int y_stride, bool relu) const
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (use_simd) {
+        dense_avx2(layer.w.data(), layer.bias.data(), layer.n_out, layer.in_stride, x, batch, y, y_stride, relu);
+        return;
+    }
+#endif
+    dense_scalar(layer.w.data(), layer.bias.data(), layer.n_out, layer.in_stride, x, batch, y, y_stride, relu);
+}
+
+// ##########################################################################
+// #             the network
+// ##########################################################################
+
+void NeuralNet::init_random(int size, const vector<int> &hidden, unsigned seed)
+{
+    if (hidden.empty() || hidden.size() > max_hidden)
+        throw invalid_argument("A network needs 1 to 4 hidden layers.");
+    edge_len = size;
+    n_cells = size * size;
+    layers.clear();
+
+    mt19937 gen(seed);
+    int n_in = input_size();
+    vector<int> widths(hidden);
+    widths.push_back(n_cells); // policy
+    for (size_t k = 0; k <= widths.size(); k++) {
+        bool value_head = k == widths.size();
+        int n_out = (value_head ? 1 : widths[k]);
+        int from = n_in; // both heads read the last hidden layer
+        Layer layer{from, n_out, round8(from), {}, {}};
+        layer.w.assign(size_t(n_out) * layer.in_stride, 0.0f);
+        layer.bias.assign(n_out, 0.0f);
+        normal_distribution<float> dist(0.0f, sqrt(2.0f / from)); // He initialization
+        for (int o = 0; o < n_out; o++)
+            for (int i = 0; i < from; i++)
+                layer.w[size_t(o) * layer.in_stride + i] = dist(gen) * (k < hidden.size() ? 1.0f : 0.1f);
+        layers.push_back(move(layer));
+        if (k < hidden.size())
+            n_in = hidden[k];
+    }
+}
+
+bool NeuralNet::load(const string &filename, int size)
+{
+    ifstream infile(filename, ios::in | ios::binary);
+    if (!infile.is_open())
+        return false; // no network: the searches use their static evaluations
+
+    NetHeader hdr;
+    if (!infile.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) || strncmp(hdr.magic, "HEXNET", 8) != 0 ||
+        hdr.version != net_version || hdr.edge_len != uint32_t(size) || hdr.n_hidden == 0 ||
+        hdr.n_hidden > max_hidden)
+        return false;
+
+    vector<int> widths(hdr.hidden, hdr.hidden + hdr.n_hidden);
+    init_random(size, widths, 0); // lays out the layers; the weights are overwritten below
+    vector<float> row;
+    for (Layer &layer : layers) {
+        row.resize(layer.n_in);
+        for (int o = 0; o < layer.n_out; o++) {
+            if (!infile.read(reinterpret_cast<char *>(row.data()), row.size() * sizeof(float))) {
+                layers.clear();
+                return false;
+            }
+            copy(row.begin(), row.end(), layer.w.begin() + size_t(o) * layer.in_stride);
+        }
+        if (!infile.read(reinterpret_cast<char *>(layer.bias.data()), layer.bias.size() * sizeof(float))) {
+            layers.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void NeuralNet::write(const string &filename) const
+{
+    NetHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "HEXNET", 7);
+    hdr.version = net_version;
+    hdr.edge_len = edge_len;
+    hdr.n_hidden = layers.size() - 2;
+    for (uint32_t k = 0; k < hdr.n_hidden; k++)
+        hdr.hidden[k] = layers[k].n_out;
+
+    ofstream outfile(filename, ios::out | ios::binary | ios::trunc);
+    if (!(outfile.is_open())) {
+        throw invalid_argument("Error opening file.");
+    }
+    outfile.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    for (const Layer &layer : layers) {
+        for (int o = 0; o < layer.n_out; o++)
+            outfile.write(reinterpret_cast<const char *>(&layer.w[size_t(o) * layer.in_stride]),
+                          layer.n_in * sizeof(float));
+        outfile.write(reinterpret_cast<const char *>(layer.bias.data()), layer.bias.size() * sizeof(float));
+    }
+    outfile.close();
+}
+
+// playerO sees the board transposed; transposing twice is the identity
+int NeuralNet::board_index(int linear, Hex::Marker side) const
+{
+    if (side == Hex::Marker::playerX)
+        return linear;
+    return (linear % edge_len) * edge_len + linear / edge_len;
+}
+
+void NeuralNet::encode(const Hex &hb, Hex::Marker side, float *input) const
+{
+    fill(input, input + input_size(), 0.0f);
+    for (int idx = 0; idx < n_cells; idx++) {
+        Hex::Marker m = hb.get_hex_Marker(idx);
+        if (m == Hex::Marker::empty)
+            continue;
+        input[(m == side ? 0 : n_cells) + board_index(idx, side)] = 1.0f;
+    }
+}
+
+void NeuralNet::forward(const float *inputs, int batch, float *logits, float *values)
+{
+    int n_hidden = layers.size() - 2;
+    size_t width = round8(input_size());
+    for (const Layer &layer : layers)
+        width = max<size_t>(width, round8(layer.n_out));
+    act_a.resize(batch * width);
+    act_b.resize(batch * width);
+
+    // the first layer reads rows padded to a multiple of 8
+    int stride = layers[0].in_stride;
+    input_pad.assign(size_t(batch) * stride, 0.0f);
+    for (int b = 0; b < batch; b++)
+        copy(inputs + size_t(b) * input_size(), inputs + size_t(b + 1) * input_size(), &input_pad[size_t(b) * stride]);
+
+    const float *x = input_pad.data();
+    float *y = act_a.data();
+    for (int k = 0; k < n_hidden; k++) {
+        const Layer &layer = layers[k];
+        int y_stride = round8(layer.n_out);
+        fill(y, y + size_t(batch) * y_stride, 0.0f); // zero padding for the next layer
+        dense(layer, x, batch, y, y_stride, true);
+        x = y;
+        y = (y == act_a.data() ? act_b.data() : act_a.data());
+    }
+    dense(layers[n_hidden], x, batch, logits, n_cells, false);
+    dense(layers[n_hidden + 1], x, batch, values, 1, false);
+    for (int b = 0; b < batch; b++)
+        values[b] = tanh(values[b]);
+}
+
+void NeuralNet::finish(const Hex &hb, Hex::Marker side, const float *logits, float value, NnOutput &out) const
+{
+    out.policy.assign(n_cells, 0.0f);
+    out.value = value;
+    float top = -1e30f;
+    for (int idx = 0; idx < n_cells; idx++) {
+        if (hb.isblank(idx))
+            top = max(top, logits[board_index(idx, side)]);
+    }
+    float sum = 0.0f;
+    for (int idx = 0; idx < n_cells; idx++) {
+        if (hb.isblank(idx)) {
+            out.policy[idx] = exp(logits[board_index(idx, side)] - top);
+            sum += out.policy[idx];
+        }
+    }
+    if (sum > 0.0f) {
+        for (float &p : out.policy)
+            p /= sum;
+    }
+}
+
+void NeuralNet::evaluate(const Hex &hb, Hex::Marker side, NnOutput &out)
+{
+    eval_input.resize(input_size());
+    eval_logits.resize(n_cells);
+    float value;
+    encode(hb, side, eval_input.data());
+    forward(eval_input.data(), 1, eval_logits.data(), &value);
+    finish(hb, side, eval_logits.data(), value, out);
+}
+
+// ##########################################################################
+// #             batching requests from many threads
+// ##########################################################################
+
+NnBatcher::NnBatcher(NeuralNet &net, int n_clients, int max_batch, int max_wait_us)
+    : net(net), n_clients(n_clients), max_batch(max_batch), max_wait_us(max_wait_us)
+{
+    queue.reserve(max_batch);
+    inputs.resize(size_t(max_batch) * net.input_size());
+    logits.resize(size_t(max_batch) * net.get_edge_len() * net.get_edge_len());
+    values.resize(max_batch);
+    batcher = thread(&NnBatcher::run, this);
+}
+
+NnBatcher::~NnBatcher()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake_batcher.notify_one();
+    batcher.join();
+}
+
+void NnBatcher::evaluate(const Hex &hb, Hex::Marker side, NnOutput &out)
+{
+    thread_local vector<float> input, raw;
+    input.resize(net.input_size());
+    raw.resize(net.get_edge_len() * net.get_edge_len());
+    net.encode(hb, side, input.data());
+
+    Request req{input.data(), raw.data(), 0.0f, false};
+    {
+        unique_lock<mutex> guard(lock);
+        wake_clients.wait(guard, [&] { return queue.size() < size_t(max_batch); });
+        queue.push_back(&req);
+        if (queue.size() == 1 || queue.size() >= size_t(min(n_clients, max_batch)))
+            wake_batcher.notify_one();
+        wake_clients.wait(guard, [&] { return req.done; });
+    }
+    n_requests.fetch_add(1, memory_order_relaxed);
+    net.finish(hb, side, raw.data(), req.value, out);
+}
+
+void NnBatcher::run()
+{
+    int n_in = net.input_size();
+    int n_cells = net.get_edge_len() * net.get_edge_len();
+    vector<Request *> batch;
+    batch.reserve(max_batch);
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock);
+            wake_batcher.wait(guard, [&] { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            // give the other clients a moment to join the batch
+            auto full = [&] { return stopping || queue.size() >= size_t(min(n_clients, max_batch)); };
+            wake_batcher.wait_for(guard, chrono::microseconds(max_wait_us), full);
+            batch.assign(queue.begin(), queue.end());
+            queue.clear();
+        }
+        wake_clients.notify_all(); // room in the queue again
+
+        int n = batch.size();
+        for (int b = 0; b < n; b++)
+            copy(batch[b]->input, batch[b]->input + n_in, &inputs[size_t(b) * n_in]);
+        net.forward(inputs.data(), n, logits.data(), values.data());
+        n_batches.fetch_add(1, memory_order_relaxed);
+
+        {
+            lock_guard<mutex> guard(lock);
+            for (int b = 0; b < n; b++) {
+                copy(&logits[size_t(b) * n_cells], &logits[size_t(b + 1) * n_cells], batch[b]->logits);
+                batch[b]->value = values[b];
+                batch[b]->done = true;
+            }
+        }
+        wake_clients.notify_all();
+    }
+}
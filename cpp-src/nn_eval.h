@@ -0,0 +1,160 @@
+// ##########################################################################
+// #             Definition/Declaration of Classes NeuralNet and NnBatcher
+// ##########################################################################
+
+#ifndef NN_EVAL_H
+#define NN_EVAL_H
+
+/*
+A small policy/value network for one board size, run on the cpu with no outside library.
+
+The network is a multilayer perceptron:
+    input    2 planes of edge_len * edge_len: the side to move's markers, the opponent's
+    hidden   up to 4 fully connected layers with ReLU
+    policy   one logit per hex: softmax over the empty hexes gives the prior of each move
+    value    tanh: the expected result for the side to move, -1 loss to 1 win
+The board is always presented as if playerX were to move: for playerO it is transposed,
+which turns connecting left to right into connecting top to bottom, so one network plays both
+sides. Policy indices are transposed back before they are returned.
+
+Inference is fp32. The dense layers use AVX2 and FMA when the cpu has them (checked at
+run time, so the program still runs everywhere) and plain loops otherwise. A batch of
+positions goes through each layer together: every weight row is loaded once for 4 positions.
+
+NnBatcher lets many search threads share one network. evaluate() queues the position and
+waits. A batching thread runs one forward pass for everything queued as soon as every client
+thread is waiting, the batch is full or max_wait_us has passed since the first request.
+Both are an NnEvaluator, so Hex::network can hold either: a single searching thread uses the
+NeuralNet directly, since with one client a batch never holds more than one position and the
+handoff to the batching thread only adds latency.
+
+Weights file "Hex Net NxN.bin":
+    NetHeader
+    for each layer (hidden layers, then policy, then value): weights[n_out][n_in], bias[n_out]
+as little endian floats. hex net size [hidden ...] writes a randomly initialized network,
+the starting point for training on self-play records.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+struct NetHeader {
+    char magic[8];        // "HEXNET"
+    uint32_t version;
+    uint32_t edge_len;
+    uint32_t n_hidden;    // number of hidden layers
+    uint32_t hidden[4];   // their widths
+};
+
+struct NnOutput {
+    vector<float> policy; // prior of each linear index: 0 for occupied hexes
+    float value = 0.0f;   // for the side to move
+};
+
+// a network evaluation of one position: the NeuralNet itself or an NnBatcher sharing it
+class NnEvaluator {
+  public:
+    virtual ~NnEvaluator() = default;
+    virtual void evaluate(const Hex &hb, Hex::Marker side, NnOutput &out) = 0;
+};
+
+class NeuralNet : public NnEvaluator {
+  public:
+    static const int max_hidden = 4;
+
+    bool load(const string &filename, int edge_len); // false if no usable network
+    void write(const string &filename) const;
+    void init_random(int edge_len, const vector<int> &hidden, unsigned seed);
+
+    int get_edge_len() const { return edge_len; }
+    int input_size() const { return 2 * n_cells; }
+    bool is_loaded() const { return !layers.empty(); }
+
+    bool use_simd = has_avx2(); // false to time the plain loops
+
+    // the network's input for the position: input_size() floats
+    void encode(const Hex &hb, Hex::Marker side, float *input) const;
+    // raw outputs for a batch: n_cells policy logits (network orientation) and one value each.
+    // Uses the network's scratch memory, so one thread at a time: share with NnBatcher.
+    void forward(const float *inputs, int batch, float *logits, float *values);
+    // softmax over the empty hexes in board orientation
+    void finish(const Hex &hb, Hex::Marker side, const float *logits, float value, NnOutput &out) const;
+    // encode, forward and finish one position: one thread at a time like forward
+    void evaluate(const Hex &hb, Hex::Marker side, NnOutput &out) override;
+
+    static bool has_avx2();
+
+  private:
+    struct Layer {
+        int n_in, n_out;
+        int in_stride;      // n_in rounded up to 8
+        vector<float> w;    // n_out rows of in_stride, zero padded
+        vector<float> bias;
+    };
+
+    int edge_len = 0;
+    int n_cells = 0;
+    vector<Layer> layers; // hidden layers, then policy, then value
+    vector<float> act_a, act_b, input_pad;
+    vector<float> eval_input, eval_logits; // scratch for evaluate
+
+    int board_index(int linear, Hex::Marker side) const; // board to network orientation and back
+    void dense(const Layer &layer, const float *x, int batch, float *y, int y_stride, bool relu) const;
+};
+
+class NnBatcher : public NnEvaluator {
+  public:
+    struct Stats {
+        long n_requests = 0;
+        long n_batches = 0;
+    };
+
+    NnBatcher(NeuralNet &net, int n_clients = 1, int max_batch = 32, int max_wait_us = 200);
+    ~NnBatcher();
+    NnBatcher(const NnBatcher &) = delete;
+    NnBatcher &operator=(const NnBatcher &) = delete;
+
+    NeuralNet &net;
+    int n_clients; // threads that call evaluate: a batch runs as soon as all of them wait
+
+    void evaluate(const Hex &hb, Hex::Marker side, NnOutput &out) override; // thread-safe, blocks
+
+    Stats get_stats() const { return {n_requests.load(), n_batches.load()}; }
+
+  private:
+    struct Request {
+        const float *input;
+        float *logits;
+        float value;
+        bool done;
+    };
+
+    int max_batch;
+    int max_wait_us;
+    mutex lock;
+    condition_variable wake_batcher, wake_clients;
+    vector<Request *> queue;
+    bool stopping = false;
+    atomic<long> n_requests{0}, n_batches{0};
+    vector<float> inputs, logits, values;
+    thread batcher;
+
+    void run();
+};
+
+// default file name of the network for a board size
+inline string net_filename(int edge_len)
+{
+    return "Hex Net " + to_string(edge_len) + "x" + to_string(edge_len) + ".bin";
+}
+
+#endif
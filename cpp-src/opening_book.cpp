@@ -0,0 +1,247 @@
+// ##########################################################################
+// #             Class OpeningBook methods and the offline book builder
+// ##########################################################################
+
+#include "opening_book.h"
+#include "hex.h"
+
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+const uint32_t book_version = 2;
+
+// map the book file into memory. Returns false if there is no file or it is for another board size.
+bool OpeningBook::open(const string &filename, int edge_len)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false; // no book: the game simulates every move
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(BookHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping stays valid after the file is closed
+    if (addr == MAP_FAILED)
+        return false;
+
+    mapped = addr;
+    mapped_len = st.st_size;
+    header = static_cast<const BookHeader *>(mapped);
+
+    size_t expected = sizeof(BookHeader) + size_t(header->n_slots) * sizeof(BookEntry);
+    if (strncmp(header->magic, "HEXBOOK", 8) != 0 || header->version != book_version
+        || header->edge_len != uint32_t(edge_len) || header->n_slots == 0
+        || (header->n_slots & (header->n_slots - 1)) != 0 || mapped_len < expected) {
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const BookEntry *>(static_cast<const char *>(mapped) + sizeof(BookHeader));
+    return true;
+}
+
+void OpeningBook::close()
+{
+    if (mapped != nullptr)
+        munmap(mapped, mapped_len);
+    mapped = nullptr;
+    mapped_len = 0;
+    header = nullptr;
+    entries = nullptr;
+}
+
+int OpeningBook::lookup(uint64_t hash) const
+{
+    const BookEntry *entry = find(hash);
+    return entry != nullptr ? entry->move : -1;
+}
+
+const BookEntry *OpeningBook::find(uint64_t hash) const
+{
+    if (entries == nullptr)
+        return nullptr;
+
+    uint32_t mask = header->n_slots - 1;
+    for (uint32_t slot = hash & mask, probes = 0; probes != header->n_slots; slot = (slot + 1) & mask, ++probes) {
+        if (entries[slot].hash == hash)
+            return &entries[slot];
+        if (entries[slot].hash == 0)
+            break; // empty slot ends the probe sequence
+    }
+    return nullptr;
+}
+
+// write the entries as an open addressing hash table at most half full
+void OpeningBook::write(const string &filename, int edge_len, int plies, int n_trials,
+                        const vector<BookEntry> &book_entries)
+{
+    uint32_t n_slots = 16;
+    while (n_slots < 2 * book_entries.size())
+        n_slots *= 2;
+
+    vector<BookEntry> table(n_slots, BookEntry{0, -1, 0});
+    uint32_t mask = n_slots - 1;
+    for (const auto &e : book_entries) {
+        uint32_t slot = e.hash & mask;
+        while (table[slot].hash != 0 && table[slot].hash != e.hash)
+            slot = (slot + 1) & mask;
+        table[slot] = e;
+    }
+
+    BookHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "HEXBOOK", 8);
+    hdr.version = book_version;
+    hdr.edge_len = edge_len;
+    hdr.n_slots = n_slots;
+    hdr.n_entries = book_entries.size();
+    hdr.plies = plies;
+    hdr.n_trials = n_trials;
+
+    ofstream outfile(filename, ios::out | ios::binary | ios::trunc);
+    if (!(outfile.is_open())) {
+        throw invalid_argument("Error opening file.");
+    }
+    outfile.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    outfile.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(BookEntry));
+    outfile.close();
+}
+
+namespace {
+
+// a position in the book tree: the moves from the empty board and which side the computer plays
+struct BookNode {
+    vector<int> moves;
+    Hex::Marker computer;
+};
+
+Hex::Marker side_to_move(int ply) { return ply % 2 == 0 ? Hex::Marker::playerX : Hex::Marker::playerO; }
+
+} // namespace
+
+/*
+Build the book level by level. The book must answer for the computer playing either side:
+at a position where the computer moves, simulate with the big budget and follow only the best move;
+at a position where the person moves, follow every possible reply. Positions where the computer
+moves are evaluated in parallel, one Hex object per thread.
+*/
+int build_opening_book(int edge_len, int plies, int n_trials, const string &filename)
+{
+    Hex proto(edge_len); // walks the book tree with make_move and unmake_move to hash positions
+    proto.make_board();
+
+    vector<BookEntry> book_entries;
+    unordered_set<uint64_t> in_book;
+    vector<BookNode> level{BookNode{{}, Hex::Marker::playerX}, BookNode{{}, Hex::Marker::playerO}};
+    int n_threads = max(1u, thread::hardware_concurrency());
+    unsigned base_seed = chrono::system_clock::now().time_since_epoch().count();
+
+    for (int ply = 0; ply != plies && !level.empty(); ++ply) {
+        Hex::Marker side = side_to_move(ply);
+        Hex::Marker other = side_to_move(ply + 1);
+
+        // the computer moves at these positions: drop transpositions before the expensive part
+        vector<BookNode> to_eval;
+        for (const auto &node : level) {
+            if (node.computer != side)
+                continue;
+            for (int i = 0; i != node.moves.size(); ++i)
+                proto.make_move(side_to_move(i), node.moves[i]);
+            bool rotated;
+            uint64_t h = proto.canonical_hash(rotated);
+            for (int i = 0; i != node.moves.size(); ++i)
+                proto.unmake_move();
+            if (in_book.insert(h).second)
+                to_eval.push_back(node);
+        }
+
+        vector<BookEntry> results(to_eval.size());
+        atomic<int> next_node{0};
+        auto worker = [&]() {
+            for (int n = next_node++; n < to_eval.size(); n = next_node++) {
+                Hex hb(edge_len);
+                hb.make_board();
+                hb.reseed(base_seed + 7919 * (n + 1) + ply);
+                for (int i = 0; i != to_eval[n].moves.size(); ++i)
+                    hb.make_move(side_to_move(i), to_eval[n].moves[i]);
+
+                const vector<int> &wins = hb.evaluate_moves(side, n_trials, other);
+                const vector<int> &empties = hb.get_empty_idxs();
+                int best = 0;
+                for (int j = 1; j != wins.size(); ++j) {
+                    if (wins[j] > wins[best])
+                        best = j;
+                }
+                bool rotated;
+                uint64_t h = hb.canonical_hash(rotated);
+                int move = rotated ? hb.rotate(empties[best]) : empties[best];
+                results[n] = BookEntry{h, move, int32_t(1000LL * wins[best] / n_trials)};
+            }
+        };
+        vector<thread> workers;
+        for (int t = 0; t != n_threads; ++t)
+            workers.emplace_back(worker);
+        for (auto &w : workers)
+            w.join();
+
+        book_entries.insert(book_entries.end(), results.begin(), results.end());
+        cout << "ply " << ply + 1 << ": " << to_eval.size() << " positions added to the book\n";
+
+        // next level: the computer's book move or every reply by the person
+        unordered_map<uint64_t, int> best_move;
+        for (const auto &e : book_entries)
+            best_move[e.hash] = e.move;
+
+        vector<BookNode> next_level;
+        unordered_set<uint64_t> seen;
+        for (const auto &node : level) {
+            for (int i = 0; i != node.moves.size(); ++i)
+                proto.make_move(side_to_move(i), node.moves[i]);
+            bool rotated;
+            uint64_t h = proto.canonical_hash(rotated);
+
+            if (node.computer == side) {
+                BookNode child = node;
+                child.moves.push_back(rotated ? proto.rotate(best_move[h]) : best_move[h]);
+                next_level.push_back(child);
+            }
+            else {
+                for (int idx = 0; idx != edge_len * edge_len; ++idx) {
+                    if (!proto.isblank(idx))
+                        continue;
+                    proto.make_move(side, idx);
+                    bool is_new = seen.insert(proto.canonical_hash(rotated)).second; // a reply and its rotation are one position
+                    proto.unmake_move();
+                    if (is_new) {
+                        BookNode child = node;
+                        child.moves.push_back(idx);
+                        next_level.push_back(child);
+                    }
+                }
+            }
+            for (int i = 0; i != node.moves.size(); ++i)
+                proto.unmake_move();
+        }
+        level.swap(next_level);
+    }
+
+    OpeningBook::write(filename, edge_len, plies, n_trials, book_entries);
+    return book_entries.size();
+}
@@ -0,0 +1,79 @@
+// ##########################################################################
+// #             Definition/Declaration of Class OpeningBook
+// ##########################################################################
+
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+/*
+The opening book holds the computer's best move for positions in the first few plies.
+The book is built offline with a big simulation budget (hex book size plies n_trials)
+and saved as a hash table in a binary file. The game maps the file into memory at
+startup and looks up each position before simulating: a hit makes the move instant.
+
+File layout:
+    BookHeader                       32 bytes
+    BookEntry[n_slots]               16 bytes each; n_slots is a power of 2
+Positions are keyed by Hex::canonical_hash and moves are stored in the canonical
+orientation, so one entry serves a position and its 180 degree rotation.
+A slot with hash == 0 is empty. Lookup starts at slot hash & (n_slots - 1) and probes
+linearly until it finds the hash or an empty slot.
+*/
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct BookHeader {
+    char magic[8];      // "HEXBOOK"
+    uint32_t version;
+    uint32_t edge_len;
+    uint32_t n_slots;
+    uint32_t n_entries;
+    uint32_t plies;     // positions with fewer than plies markers are in the book
+    uint32_t n_trials;  // simulation budget used to build the book
+};
+
+struct BookEntry {
+    uint64_t hash;      // Hex::canonical_hash of the position
+    int32_t move;       // linear index of the best move in the canonical orientation
+    int32_t win_permille; // simulated win rate of the move * 1000
+};
+
+class OpeningBook {
+  public:
+    OpeningBook() = default;
+    ~OpeningBook() { close(); }
+    OpeningBook(const OpeningBook &) = delete;
+    OpeningBook &operator=(const OpeningBook &) = delete;
+
+    bool open(const string &filename, int edge_len); // false if no usable book
+    void close();
+    bool is_open() const { return entries != nullptr; }
+
+    // linear index of the book move for the position or -1 if the position isn't in the book
+    int lookup(uint64_t hash) const;
+    const BookEntry *find(uint64_t hash) const; // the whole entry or nullptr
+
+    static void write(const string &filename, int edge_len, int plies, int n_trials,
+                      const vector<BookEntry> &book_entries);
+
+  private:
+    void *mapped = nullptr;
+    size_t mapped_len = 0;
+    const BookHeader *header = nullptr;
+    const BookEntry *entries = nullptr;
+};
+
+// default file name of the book for a board size
+inline string book_filename(int edge_len)
+{
+    return "Hex Book " + to_string(edge_len) + "x" + to_string(edge_len) + ".bin";
+}
+
+// build the book offline with the simulation engine: returns the number of positions
+int build_opening_book(int edge_len, int plies, int n_trials, const string &filename);
+
+#endif
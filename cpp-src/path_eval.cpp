@@ -0,0 +1,78 @@
+// ##########################################################################
+// #             Class Hex methods for static evaluation by path distances
+// ##########################################################################
+
+/*
+Cheap evaluations of a position that don't simulate any games, using the path evaluators
+of class Graph on the shared board graph (see graph.h and board_topology.h):
+
+shortest_distance   number of empty hexes a side still needs to connect its borders:
+                    0-1 BFS from the start border, own markers cost 0, empty hexes cost 1.
+                    0 means the side has already won.
+two_distance        the smallest "potential" of an empty hex: its two-distance from the start
+                    border plus its two-distance from the finish border. Two-distance assumes
+                    the opponent blocks the best way forward at every step, so it measures how
+                    hard a connection is to stop, not just how short it is.
+static_eval         the opponent's two_distance minus the side's: above 0 is good for the side.
+
+evaluate_moves uses shortest_distance to score a move that wins at once without simulating it.
+*/
+
+#include "hex.h"
+
+using namespace std;
+
+int Hex::shortest_distance(Marker side)
+{
+    const Graph<int> &graph = topology->graph;
+    graph.zero_one_bfs(start_border[enum2int(side)], positions.data(), side, Marker::empty, path_buffers);
+
+    int best = path_blocked;
+    for (int idx : finish_border[enum2int(side)])
+        best = min(best, path_buffers.dist[idx]);
+    return best;
+}
+
+int Hex::winning_move(Marker side)
+{
+    if (shortest_distance(side) != 1)
+        return -1;
+    for (int idx : empty_idxs) {
+        positions[idx] = side;
+        bool won = shortest_distance(side) == 0;
+        positions[idx] = Marker::empty;
+        if (won)
+            return idx;
+    }
+    return -1;
+}
+
+int Hex::two_distance(Marker side)
+{
+    if (shortest_distance(side) == 0)
+        return 0; // already connected
+
+    const Graph<int> &graph = topology->graph;
+    graph.two_distance(start_border[enum2int(side)], positions.data(), side, Marker::empty, path_buffers);
+    td_start.assign(path_buffers.dist.begin(), path_buffers.dist.end());
+    graph.two_distance(finish_border[enum2int(side)], positions.data(), side, Marker::empty, path_buffers);
+
+    int best = path_blocked;
+    for (int idx : empty_idxs) {
+        if (positions[idx] == Marker::empty)
+            best = min(best, td_start[idx] + path_buffers.dist[idx]);
+    }
+    return min(best, path_blocked);
+}
+
+int Hex::static_eval(Marker side)
+{
+    Marker other = (side == Marker::playerX ? Marker::playerO : Marker::playerX);
+    int mine = two_distance(side);
+    int theirs = two_distance(other);
+    if (mine == 0)
+        return path_blocked; // won
+    if (theirs == 0)
+        return -path_blocked; // lost
+    return theirs - mine;
+}
@@ -0,0 +1,157 @@
+// ##########################################################################
+// #             Class Hex methods to simulate games in batches
+// ##########################################################################
+
+/*
+simulate_hexboard_positions plays one simulated game at a time on the game board:
+shuffle, write every marker, trace the winner, repeat. simulate_batch does the same work
+for batch_size games at a time on scratch boards:
+    1. shuffle batch_size copies of the empty positions into one interleaved buffer
+    2. copy the position into each scratch board
+    3. fill the boards in lock-step: step i places the same marker on every board, reading
+       batch_size consecutive permutation entries
+    4. trace the winner of each board using the flat neighbor table and a pre-allocated stack
+    5. add up the wins in one simple loop
+The game board is only read, so the trial markers never have to be cleared from it.
+With bridge aware games the fill depends on the markers already placed, so step 3 fills
+one board at a time in that case.
+*/
+
+#include "hex.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+// returns the wins for computer_side over n_trials simulated games after computer_side plays move.
+// empties holds the positions to fill in the simulated games and must not include move.
+int Hex::simulate_batch(PlayoutBatch &pb, const vector<int> &empties, int move, Marker computer_side,
+                        Marker person_side, int n_trials) const
+{
+    const int n = empties.size();
+    const int K = pb.batch_size;
+    const bool split = !bridge_playouts && balanced_split_playouts;
+    const int n_person = (n + 1) / 2; // the person's marker is always placed first
+    int wins = 0;
+
+    for (int done = 0; done < n_trials; done += K) {
+        int k_games = min(K, n_trials - done);
+
+        // 1. interleaved permutations: shuffle each game's column. Without bridge replies only
+        //    the split matters: the first n_person entries of a column go to the person.
+        for (int i = 0; i != n; ++i) {
+            int *row = &pb.perms[size_t(i) * K];
+            for (int g = 0; g != k_games; ++g)
+                row[g] = empties[i];
+        }
+        for (int g = 0; g != k_games; ++g) {
+            if (split)
+                pb.rng.balanced_split(&pb.perms[g], n, n_person, K);
+            else
+                pb.rng.shuffle(&pb.perms[g], n, K);
+        }
+
+        // 2. start every scratch board from the current position plus the move
+        for (int g = 0; g != k_games; ++g) {
+            Marker *board = &pb.boards[size_t(g) * pb.board_stride];
+            memcpy(board, positions.data(), max_idx * sizeof(Marker));
+            board[move] = computer_side;
+        }
+
+        // 3. fill the boards: the person's marker is always placed first
+        if (bridge_playouts) {
+            for (int g = 0; g != k_games; ++g)
+                fill_bridge_aware(pb, &pb.boards[size_t(g) * pb.board_stride], empties, g, person_side, computer_side);
+        }
+        else {
+            Marker current = person_side;
+            Marker next = computer_side;
+            for (int i = 0; i != n; ++i) {
+                const int *row = &pb.perms[size_t(i) * K];
+                Marker m = split ? (i < n_person ? person_side : computer_side) : current;
+                for (int g = 0; g != k_games; ++g)
+                    pb.boards[size_t(g) * pb.board_stride + row[g]] = m;
+                swap(current, next);
+            }
+        }
+
+        // 4. trace the winner of each board
+        for (int g = 0; g != k_games; ++g)
+            pb.winners[g] = batch_board_winner(pb, &pb.boards[size_t(g) * pb.board_stride], computer_side) ? 1 : 0;
+
+        // 5. add up the wins
+        for (int g = 0; g != k_games; ++g)
+            wins += pb.winners[g];
+    }
+
+    return wins;
+}
+
+// same policy as simulate_hexboard_positions with bridge_playouts on: an intrusion into a
+// two-bridge is answered in the other hex of the bridge
+void Hex::fill_bridge_aware(PlayoutBatch &pb, Marker *board, const vector<int> &empties, int game,
+                            Marker person_side, Marker computer_side) const
+{
+    const int n = empties.size();
+    const int K = pb.batch_size;
+
+    pb.order.resize(n);
+    for (int i = 0; i != n; ++i) {
+        pb.order[i] = pb.perms[size_t(i) * K + game];
+        pb.order_pos[pb.order[i]] = i;
+    }
+
+    Marker current = person_side;
+    Marker next = computer_side;
+    for (int i = 0; i != n; ++i) {
+        int hex = pb.order[i];
+        board[hex] = current;
+        if (i + 1 != n) {
+            for (const auto &br : bridges[hex]) {
+                if (board[br[1]] == next && board[br[2]] == next && board[br[0]] == Marker::empty) {
+                    int j = pb.order_pos[br[0]];
+                    swap(pb.order[i + 1], pb.order[j]);
+                    pb.order_pos[pb.order[j]] = j;
+                    pb.order_pos[pb.order[i + 1]] = i + 1;
+                    break;
+                }
+            }
+        }
+        swap(current, next);
+    }
+}
+
+// true if side has a path from its start border to its finish border on a full board
+bool Hex::batch_board_winner(PlayoutBatch &pb, const Marker *board, Marker side) const
+{
+    int stamp = ++pb.stamp;
+    if (stamp == 0) { // the stamp wrapped around: reset the marks
+        fill(pb.visited.begin(), pb.visited.end(), 0);
+        stamp = pb.stamp = 1;
+    }
+
+    pb.stack.clear();
+    for (auto hex : finish_border[enum2int(side)]) {
+        if (board[hex] == side) {
+            pb.visited[hex] = stamp;
+            pb.stack.push_back(hex);
+        }
+    }
+
+    while (!pb.stack.empty()) {
+        int hex = pb.stack.back();
+        pb.stack.pop_back();
+        if (is_in_start(hex, side))
+            return true;
+        const int *nbrs = &neighbor_table[6 * hex];
+        for (int k = 0; k != 6 && nbrs[k] >= 0; ++k) {
+            int nbr = nbrs[k];
+            if (board[nbr] == side && pb.visited[nbr] != stamp) {
+                pb.visited[nbr] = stamp;
+                pb.stack.push_back(nbr);
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,52 @@
+// ##########################################################################
+// #             Class Hex methods to simulate games as bitmasks
+// ##########################################################################
+
+/*
+A full-board simulated game only depends on which positions each side gets, not the order
+they are placed. Without bridge replies, alternating markers over a shuffle just picks a random
+half of the empty positions for the person, who is always placed first. simulate_bitmask picks
+that half directly as a random bitmask with a fixed number of bits (HexBitboard::random_subset)
+and checks the computer's path on the bitmask (HexBitboard::connects). Nothing is written to a
+board: each simulated game is a few operations on each 64 bit word.
+*/
+
+#include "hex.h"
+
+using namespace std;
+
+// returns the wins for computer_side over n_trials simulated games after computer_side plays move.
+// empties holds the positions to fill in the simulated games and must not include move.
+int Hex::simulate_bitmask(PlayoutBatch &pb, const vector<int> &empties, int move, Marker computer_side,
+                          int n_trials) const
+{
+    const int n_words = bitboard.n_words;
+    uint64_t *computer_base = pb.bits.data(); // the computer's markers before the simulated game
+    uint64_t *empty_mask = computer_base + n_words;
+    uint64_t *person_half = computer_base + 2 * n_words;
+    uint64_t *own = computer_base + 3 * n_words;
+    uint64_t *scratch = computer_base + 4 * n_words; // 4 * n_words for connects
+
+    fill(computer_base, computer_base + 2 * n_words, 0);
+    for (int idx = 0; idx != max_idx; ++idx) {
+        if (get_hex_Marker(idx) == computer_side)
+            HexBitboard::set(computer_base, idx);
+    }
+    HexBitboard::set(computer_base, move);
+    for (auto idx : empties)
+        HexBitboard::set(empty_mask, idx);
+
+    const int n_person = (empties.size() + 1) / 2; // the person's marker is always placed first
+    const bool is_x = computer_side == Marker::playerX;
+    const uint64_t *from = is_x ? bitboard.top.data() : bitboard.left.data();
+    const uint64_t *to = is_x ? bitboard.bottom.data() : bitboard.right.data();
+
+    int wins = 0;
+    for (int trial = 0; trial != n_trials; ++trial) {
+        bitboard.random_subset(empty_mask, n_person, person_half, pb.rng);
+        for (int w = 0; w != n_words; ++w)
+            own[w] = computer_base[w] | (empty_mask[w] & ~person_half[w]);
+        wins += bitboard.connects(own, from, to, scratch) ? 1 : 0;
+    }
+    return wins;
+}
@@ -0,0 +1,118 @@
+// ##########################################################################
+// #             Definition/Declaration of Class PlayoutRng
+// ##########################################################################
+
+#ifndef PLAYOUT_RNG_H
+#define PLAYOUT_RNG_H
+
+/*
+Random numbers for the simulated games. Shuffling the empty positions is a large part of
+the cost of a simulated game, and std::shuffle with std::minstd_rand makes one generator call
+and one division-based distribution draw for every element. PlayoutRng is cheaper:
+  - wyrand: one multiply per 64 bit random word
+  - Lemire's nearly divisionless bounded random: a multiply and a shift; the division only
+    happens in the rare case that the result might be biased
+  - a 64 bit word is split into four 16 bit draws when the range fits in 16 bits, which is
+    every board up to 255x255, so one generator call gives 4 shuffle indices
+  - balanced_split only draws the first half of a shuffle. A full-board simulated game only
+    depends on which positions each side gets, not the order they are placed, so alternating
+    markers over a shuffle is the same as giving a random half of the positions to the side
+    that moves first.
+*/
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class PlayoutRng {
+  public:
+    explicit PlayoutRng(uint64_t seed = 0x2545f4914f6cdd1dULL) { this->seed(seed); }
+
+    void seed(uint64_t s)
+    {
+        state = s;
+        n_chunks = 0;
+    }
+
+    // wyrand by Wang Yi: passes BigCrush and PractRand, one 128 bit multiply per word
+    uint64_t next()
+    {
+        state += 0xa0761d6478bd642fULL;
+        __uint128_t m = (__uint128_t)state * (state ^ 0xe7037ed1a0b428dbULL);
+        return uint64_t(m >> 64) ^ uint64_t(m);
+    }
+
+    // uniform in [0, range): Lemire's method on 16 bit chunks of a random word when range is small
+    uint32_t bounded(uint32_t range)
+    {
+        if (range <= (1u << 16))
+            return bounded16(range);
+
+        uint64_t m = uint64_t(uint32_t(next())) * range;
+        uint32_t low = uint32_t(m);
+        if (low < range) {
+            uint32_t threshold = uint32_t(-range) % range;
+            while (low < threshold) {
+                m = uint64_t(uint32_t(next())) * range;
+                low = uint32_t(m);
+            }
+        }
+        return uint32_t(m >> 32);
+    }
+
+    // Fisher-Yates shuffle of n elements spaced stride apart
+    void shuffle(int *first, int n, int stride = 1)
+    {
+        for (int i = n - 1; i > 0; --i) {
+            int j = bounded(i + 1);
+            swap(first[size_t(i) * stride], first[size_t(j) * stride]);
+        }
+    }
+
+    void shuffle(vector<int> &v) { shuffle(v.data(), v.size()); }
+
+    // move a random subset of n_first of the n elements to the front: only the first
+    // n_first steps of a shuffle. The order within each part is not random.
+    void balanced_split(int *first, int n, int n_first, int stride = 1)
+    {
+        for (int i = 0; i != n_first && i != n - 1; ++i) {
+            int j = i + bounded(n - i);
+            swap(first[size_t(i) * stride], first[size_t(j) * stride]);
+        }
+    }
+
+  private:
+    uint64_t state;
+    uint64_t chunks = 0; // unused 16 bit chunks of the last random word
+    int n_chunks = 0;
+
+    uint32_t next16()
+    {
+        if (n_chunks == 0) {
+            chunks = next();
+            n_chunks = 4;
+        }
+        uint32_t x = uint32_t(chunks & 0xffff);
+        chunks >>= 16;
+        --n_chunks;
+        return x;
+    }
+
+    uint32_t bounded16(uint32_t range)
+    {
+        uint32_t m = next16() * range;
+        uint32_t low = m & 0xffff;
+        if (low < range) {
+            uint32_t threshold = ((1u << 16) - range) % range;
+            while (low < threshold) {
+                m = next16() * range;
+                low = m & 0xffff;
+            }
+        }
+        return m >> 16;
+    }
+};
+
+#endif
@@ -0,0 +1,143 @@
+// ##########################################################################
+// #             Class Hex methods for the electrical resistance evaluation
+// ##########################################################################
+
+/*
+The board as a resistor network for one side: current flows from the side's start border
+(held at 1 volt) to its finish border (0 volts) through the hexes. Each hex is a resistor:
+    the side's own marker   own_resistance (nearly 0: conducts)
+    empty                   1
+    the opponent's marker   blocks: takes no part in the network
+Two adjacent hexes i and j are joined by a conductance 1 / (r_i + r_j); a hex on a border is
+joined to the border by 1 / r_i. Solving for the voltages is a sparse symmetric linear system,
+one row per hex (see sparse_matrix.h). The total current out of the start border gives the
+network's resistance: the fewer and the more open the paths, the higher the resistance.
+
+resistance_eval compares the two sides: log(R of the opponent / R of the side), above 0 is good
+for the side. That is one solve per side per position, in place of thousands of simulated games,
+so it suits a leaf evaluator for a game tree search.
+
+resistance_priors gives the current flowing through each empty hex, summed over both sides:
+hexes that carry a lot of current matter to both players, which makes it a cheap prior for
+choosing which moves to search first.
+
+The matrix pattern is made on the first call and reused. The voltages of each side are kept,
+so the next solve (usually one or two moves later) starts from a good guess.
+*/
+
+#include "hex.h"
+
+#include <cmath>
+
+using namespace std;
+
+const double own_resistance = 0.01;
+const double empty_resistance = 1.0;
+const double leak = 1e-6; // keeps areas walled off from both borders from making the matrix singular
+
+void Hex::setup_conductance()
+{
+    vector<vector<int>> nbrs(max_idx);
+    for (int i = 0; i != max_idx; ++i) {
+        for (int k = 0; k != 6; ++k) {
+            if (neighbor_table[6 * i + k] >= 0)
+                nbrs[i].push_back(neighbor_table[6 * i + k]);
+        }
+    }
+    conductance.set_pattern(nbrs);
+    cell_resistance.assign(max_idx, 0.0);
+    rhs.assign(max_idx, 0.0);
+    for (auto &v : voltages)
+        v.assign(max_idx, 0.5);
+}
+
+// build the network for side and solve it: voltages[side] holds the solution
+double Hex::resistance(Marker side)
+{
+    if (conductance.size() != max_idx)
+        setup_conductance();
+
+    for (int i = 0; i != max_idx; ++i) {
+        Marker m = positions[i];
+        cell_resistance[i] = (m == side ? own_resistance : (m == Marker::empty ? empty_resistance : 0.0));
+    }
+    auto blocked = [this](int i) { return cell_resistance[i] == 0.0; };
+
+    vector<double> &v = voltages[enum2int(side)];
+    conductance.clear_values();
+    fill(rhs.begin(), rhs.end(), 0.0);
+    for (int i = 0; i != max_idx; ++i) {
+        if (blocked(i)) {
+            conductance.add_entry(i, i, 1.0); // v[i] = 0: no part of the network
+            v[i] = 0.0;
+            continue;
+        }
+        for (int k = 0; k != 6; ++k) {
+            int j = neighbor_table[6 * i + k];
+            if (j < 0 || blocked(j))
+                continue;
+            double g = 1.0 / (cell_resistance[i] + cell_resistance[j]);
+            conductance.add_entry(i, j, -g);
+            conductance.add_entry(i, i, g);
+        }
+        conductance.add_entry(i, i, leak);
+    }
+    for (int i : start_border[enum2int(side)]) {
+        if (!blocked(i)) {
+            double g = 1.0 / cell_resistance[i];
+            conductance.add_entry(i, i, g);
+            rhs[i] += g; // joined to the border at 1 volt
+        }
+    }
+    for (int i : finish_border[enum2int(side)]) {
+        if (!blocked(i))
+            conductance.add_entry(i, i, 1.0 / cell_resistance[i]); // joined to the border at 0 volts
+    }
+
+    cg_iterations = conductance.solve_cg(rhs, v);
+
+    double current = 0.0;
+    for (int i : start_border[enum2int(side)]) {
+        if (!blocked(i))
+            current += (1.0 - v[i]) / cell_resistance[i];
+    }
+    return (current > 1e-9 ? 1.0 / current : 1e9);
+}
+
+double Hex::resistance_eval(Marker side)
+{
+    Marker other = (side == Marker::playerX ? Marker::playerO : Marker::playerX);
+    double mine = resistance(side);
+    double theirs = resistance(other);
+    return log(theirs / mine);
+}
+
+// current through each hex (indexed by linear index), summed over both sides, scaled to add up
+// to 1 over the empty hexes. Hexes with a marker get 0.
+void Hex::resistance_priors(vector<double> &priors)
+{
+    priors.assign(max_idx, 0.0);
+    for (Marker side : {Marker::playerX, Marker::playerO}) {
+        resistance(side);
+        const vector<double> &v = voltages[enum2int(side)];
+        for (int i = 0; i != max_idx; ++i) {
+            if (positions[i] != Marker::empty)
+                continue;
+            double flow = 0.0; // current in + current out = twice the current through the hex
+            for (int k = 0; k != 6; ++k) {
+                int j = neighbor_table[6 * i + k];
+                if (j >= 0 && cell_resistance[j] != 0.0)
+                    flow += fabs(v[i] - v[j]) / (cell_resistance[i] + cell_resistance[j]);
+            }
+            priors[i] += flow / 2;
+        }
+    }
+
+    double total = 0.0;
+    for (double p : priors)
+        total += p;
+    if (total > 0.0) {
+        for (double &p : priors)
+            p /= total;
+    }
+}
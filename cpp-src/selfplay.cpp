@@ -0,0 +1,376 @@
+// ##########################################################################
+// #             Self-play training data
+// ##########################################################################
+
+#include "selfplay.h"
+#include "vc_engine.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+const uint32_t selfplay_version = 1;
+const uint32_t chunk_magic = 0x4b4e4843;   // "CHNK"
+const uint32_t trailer_magic = 0x58444e49; // "INDX"
+
+static void put_varint(vector<uint8_t> &out, uint32_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+// false if the varint runs past the end
+static bool get_varint(const uint8_t *bytes, size_t len, size_t &pos, uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0; pos < len && shift < 35; shift += 7) {
+        uint8_t b = bytes[pos++];
+        v |= uint32_t(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static uint32_t fnv1a(const uint8_t *bytes, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ bytes[i]) * 16777619u;
+    return h;
+}
+
+// ##########################################################################
+// #             record encoding
+// ##########################################################################
+
+void SelfplayWriter::encode(const SelfplayRecord &rec, vector<uint8_t> &out)
+{
+    out.push_back(uint8_t(static_cast<int>(rec.side) | static_cast<int>(rec.winner) << 2));
+    put_varint(out, rec.move);
+
+    int n_cells = rec.board.size();
+    for (int i = 0; i < n_cells; i += 4) {
+        uint8_t packed = 0;
+        for (int k = 0; k < 4 && i + k < n_cells; k++)
+            packed |= uint8_t(static_cast<int>(rec.board[i + k]) << (2 * k));
+        out.push_back(packed);
+    }
+
+    uint32_t run = 0; // hexes not simulated
+    for (int idx = 0; idx < n_cells; idx++) {
+        if (rec.board[idx] != Hex::Marker::empty)
+            continue;
+        if (rec.wins[idx] < 0) {
+            run++;
+            continue;
+        }
+        if (run > 0) {
+            out.push_back(0);
+            put_varint(out, run);
+            run = 0;
+        }
+        put_varint(out, rec.wins[idx] + 1);
+    }
+    if (run > 0) {
+        out.push_back(0);
+        put_varint(out, run);
+    }
+}
+
+size_t SelfplayReader::decode(const uint8_t *bytes, size_t len, int edge_len, SelfplayRecord &rec)
+{
+    int n_cells = edge_len * edge_len;
+    size_t pos = 0;
+    if (len < 1)
+        return 0;
+    rec.side = static_cast<Hex::Marker>(bytes[pos] & 3);
+    rec.winner = static_cast<Hex::Marker>((bytes[pos] >> 2) & 3);
+    pos++;
+    uint32_t v;
+    if (!get_varint(bytes, len, pos, v))
+        return 0;
+    rec.move = v;
+
+    if (pos + (n_cells + 3) / 4 > len)
+        return 0;
+    rec.board.resize(n_cells);
+    for (int i = 0; i < n_cells; i++)
+        rec.board[i] = static_cast<Hex::Marker>((bytes[pos + i / 4] >> (2 * (i % 4))) & 3);
+    pos += (n_cells + 3) / 4;
+
+    rec.wins.assign(n_cells, -1);
+    uint32_t run = 0;
+    for (int idx = 0; idx < n_cells; idx++) {
+        if (rec.board[idx] != Hex::Marker::empty)
+            continue;
+        if (run > 0) {
+            run--;
+            continue;
+        }
+        if (!get_varint(bytes, len, pos, v))
+            return 0;
+        if (v == 0) { // a run starting here
+            if (!get_varint(bytes, len, pos, run) || run == 0)
+                return 0;
+            run--;
+            continue;
+        }
+        rec.wins[idx] = v - 1;
+    }
+    return run == 0 ? pos : 0;
+}
+
+// ##########################################################################
+// #             writer: chunks from the game threads, one thread for the file
+// ##########################################################################
+
+SelfplayWriter::SelfplayWriter(const string &filename, int edge_len, int n_trials, size_t max_queued)
+    : max_queued(max_queued)
+{
+    outfile.open(filename, ios::out | ios::binary | ios::trunc);
+    if (!(outfile.is_open())) {
+        throw invalid_argument("Error opening file.");
+    }
+    PlayHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, "HEXPLAY", 8);
+    hdr.version = selfplay_version;
+    hdr.edge_len = edge_len;
+    hdr.n_trials = n_trials;
+    outfile.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    offset = sizeof(hdr);
+    writer = thread(&SelfplayWriter::run, this);
+}
+
+void SelfplayWriter::close()
+{
+    if (closed)
+        return;
+    closed = true;
+    {
+        lock_guard<mutex> guard(lock);
+        closing = true;
+    }
+    not_empty.notify_one();
+    writer.join();
+
+    PlayTrailer trailer{offset, n_records, uint32_t(index.size()), trailer_magic};
+    outfile.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(ChunkIndex));
+    outfile.write(reinterpret_cast<const char *>(&trailer), sizeof(trailer));
+    outfile.close();
+}
+
+void SelfplayWriter::add(Chunk &chunk, const SelfplayRecord &rec)
+{
+    encode(rec, chunk.bytes);
+    chunk.n_records++;
+    if (chunk.bytes.size() >= chunk_bytes)
+        flush(chunk);
+}
+
+void SelfplayWriter::flush(Chunk &chunk)
+{
+    if (chunk.n_records == 0)
+        return;
+    {
+        unique_lock<mutex> guard(lock);
+        not_full.wait(guard, [&] { return queue.size() < max_queued; });
+        queue.push_back(move(chunk));
+    }
+    not_empty.notify_one();
+    chunk = Chunk{};
+    chunk.bytes.reserve(chunk_bytes + 1024);
+}
+
+uint64_t SelfplayWriter::records_written() const
+{
+    lock_guard<mutex> guard(lock);
+    return n_records;
+}
+
+void SelfplayWriter::run()
+{
+    while (true) {
+        Chunk chunk;
+        {
+            unique_lock<mutex> guard(lock);
+            not_empty.wait(guard, [&] { return closing || !queue.empty(); });
+            if (queue.empty())
+                return; // closing and nothing left
+            chunk = move(queue.front());
+            queue.pop_front();
+        }
+        not_full.notify_one();
+
+        ChunkHeader ch{chunk_magic, chunk.n_records, uint32_t(chunk.bytes.size()),
+                       fnv1a(chunk.bytes.data(), chunk.bytes.size())};
+        outfile.write(reinterpret_cast<const char *>(&ch), sizeof(ch));
+        outfile.write(reinterpret_cast<const char *>(chunk.bytes.data()), chunk.bytes.size());
+
+        lock_guard<mutex> guard(lock);
+        index.push_back(ChunkIndex{offset, n_records, ch.n_records, ch.n_bytes});
+        offset += sizeof(ch) + ch.n_bytes;
+        n_records += ch.n_records;
+    }
+}
+
+// ##########################################################################
+// #             reader
+// ##########################################################################
+
+bool SelfplayReader::open(const string &filename)
+{
+    infile.open(filename, ios::in | ios::binary);
+    if (!infile.is_open())
+        return false;
+    if (!infile.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        strncmp(header.magic, "HEXPLAY", 8) != 0 || header.version != selfplay_version)
+        return false;
+
+    index.clear();
+    infile.seekg(0, ios::end);
+    uint64_t file_len = infile.tellg();
+    PlayTrailer trailer;
+    if (file_len >= sizeof(header) + sizeof(trailer)) {
+        infile.seekg(file_len - sizeof(trailer));
+        infile.read(reinterpret_cast<char *>(&trailer), sizeof(trailer));
+        if (trailer.magic == trailer_magic &&
+            trailer.index_offset + trailer.n_chunks * sizeof(ChunkIndex) + sizeof(trailer) == file_len) {
+            index.resize(trailer.n_chunks);
+            infile.seekg(trailer.index_offset);
+            infile.read(reinterpret_cast<char *>(index.data()), index.size() * sizeof(ChunkIndex));
+            return bool(infile);
+        }
+    }
+
+    // no trailer: walk the chunk headers
+    infile.clear();
+    uint64_t pos = sizeof(header), first = 0;
+    ChunkHeader ch;
+    while (pos + sizeof(ch) <= file_len) {
+        infile.seekg(pos);
+        if (!infile.read(reinterpret_cast<char *>(&ch), sizeof(ch)) || ch.magic != chunk_magic ||
+            pos + sizeof(ch) + ch.n_bytes > file_len)
+            break;
+        index.push_back(ChunkIndex{pos, first, ch.n_records, ch.n_bytes});
+        first += ch.n_records;
+        pos += sizeof(ch) + ch.n_bytes;
+    }
+    infile.clear();
+    return true;
+}
+
+uint64_t SelfplayReader::n_records() const
+{
+    return index.empty() ? 0 : index.back().first_record + index.back().n_records;
+}
+
+bool SelfplayReader::read_chunk(size_t i, vector<SelfplayRecord> &records)
+{
+    const ChunkIndex &ci = index.at(i);
+    ChunkHeader ch;
+    vector<uint8_t> bytes(ci.n_bytes);
+    infile.seekg(ci.offset);
+    if (!infile.read(reinterpret_cast<char *>(&ch), sizeof(ch)) || ch.magic != chunk_magic ||
+        !infile.read(reinterpret_cast<char *>(bytes.data()), bytes.size()) ||
+        fnv1a(bytes.data(), bytes.size()) != ch.checksum)
+        return false;
+
+    records.resize(ci.n_records);
+    size_t pos = 0;
+    for (auto &rec : records) {
+        size_t used = decode(bytes.data() + pos, bytes.size() - pos, header.edge_len, rec);
+        if (used == 0)
+            return false;
+        pos += used;
+    }
+    return pos == bytes.size();
+}
+
+// ##########################################################################
+// #             the generator
+// ##########################################################################
+
+uint64_t run_selfplay(int edge_len, int n_games, int n_trials, int n_threads, const string &filename)
+{
+    const int sampled_plies = 4; // moves chosen in proportion to their wins: different games
+    WorkerPool pool(n_threads);
+    SelfplayWriter writer(filename, edge_len, n_trials);
+    atomic<int> next_game{0};
+    uint64_t base_seed = random_device{}();
+
+    pool.run([&](int w) {
+        Hex hb(edge_len); // built on the worker's thread
+        hb.make_board();
+        unique_ptr<VcEngine> vcs;
+        if (edge_len * edge_len <= VcEngine::max_cells) {
+            vcs.reset(new VcEngine(edge_len));
+            hb.vc_engine = vcs.get();
+        }
+        PlayoutRng pick(splitmix64(base_seed + w));
+        SelfplayWriter::Chunk chunk;
+        vector<SelfplayRecord> game;
+
+        for (int g = next_game++; g < n_games; g = next_game++) {
+            hb.reseed(splitmix64(base_seed ^ g));
+            while (!hb.get_move_history().empty())
+                hb.unmake_move();
+            game.clear();
+
+            Hex::Marker side = Hex::Marker::playerX;
+            while (true) {
+                Hex::Marker other = (side == Hex::Marker::playerX ? Hex::Marker::playerO : Hex::Marker::playerX);
+                const vector<int> &wins = hb.evaluate_moves(side, n_trials, other);
+                const vector<int> &empties = hb.get_empty_idxs();
+
+                SelfplayRecord rec;
+                rec.board.resize(edge_len * edge_len);
+                for (int idx = 0; idx < edge_len * edge_len; idx++)
+                    rec.board[idx] = hb.get_hex_Marker(idx);
+                rec.side = side;
+                rec.wins.assign(edge_len * edge_len, -1);
+                long total = 0;
+                int best = 0;
+                for (int i = 0; i < empties.size(); i++) {
+                    rec.wins[empties[i]] = wins[i];
+                    total += max(wins[i], 0);
+                    if (wins[i] > wins[best])
+                        best = i;
+                }
+                if (game.size() < sampled_plies && total > 0) {
+                    long r = pick.bounded(total);
+                    for (int i = 0; i < empties.size(); i++) {
+                        r -= max(wins[i], 0);
+                        if (r < 0) {
+                            best = i;
+                            break;
+                        }
+                    }
+                }
+                rec.move = empties[best];
+                hb.make_move(side, rec.move);
+                game.push_back(move(rec));
+                if (hb.shortest_distance(side) == 0)
+                    break;
+                side = other;
+            }
+
+            for (SelfplayRecord &rec : game) {
+                rec.winner = side;
+                writer.add(chunk, rec);
+            }
+        }
+        writer.flush(chunk);
+    });
+
+    writer.close();
+    return writer.records_written();
+}
@@ -0,0 +1,152 @@
+// ##########################################################################
+// #             Self-play training data: generator, record format and reader
+// ##########################################################################
+
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+/*
+hex selfplay size n_games n_trials [n_threads] plays the engine against itself on every
+cpu and records every position for training a network (see nn_eval.h):
+    the board, the side to move, the move played
+    the simulated wins of every candidate move (wins_per_move; -1 for moves not simulated)
+    the winner of the game
+Each worker thread plays whole games on its own board. The first few moves are sampled in
+proportion to their wins so the games differ; after that the best move is played.
+
+Records go into chunks of about chunk_bytes. A full chunk is handed to a bounded queue and
+one writer thread appends the chunks to the file, so the game threads only wait for the
+disk when the queue is full.
+
+File "Hex Selfplay NxN.bin":
+    PlayHeader
+    chunks: ChunkHeader then n_bytes of records
+    index:  ChunkIndex for every chunk
+    PlayTrailer
+The trailer is written when the file is closed. A file without one (the generator was
+stopped) can still be read by walking the chunk headers.
+
+A record is compact without any compression library:
+    1 byte   side to move in bits 0-1, winner in bits 2-3 (the Marker values)
+    varint   the move played
+    board    2 bits per hex (the Marker value), 4 hexes per byte
+    wins     for each empty hex in linear order: varint(wins + 1), or 0 followed by
+             varint(n) for a run of n hexes that were not simulated
+*/
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+struct PlayHeader {
+    char magic[8];      // "HEXPLAY"
+    uint32_t version;
+    uint32_t edge_len;
+    uint32_t n_trials;  // simulated games per candidate move
+    uint32_t unused;
+};
+
+struct ChunkHeader {
+    uint32_t magic;     // chunk_magic
+    uint32_t n_records;
+    uint32_t n_bytes;
+    uint32_t checksum;  // FNV-1a of the bytes
+};
+
+struct ChunkIndex {
+    uint64_t offset;    // of the ChunkHeader
+    uint64_t first_record;
+    uint32_t n_records;
+    uint32_t n_bytes;
+};
+
+struct PlayTrailer {
+    uint64_t index_offset;
+    uint64_t n_records;
+    uint32_t n_chunks;
+    uint32_t magic;     // trailer_magic
+};
+
+struct SelfplayRecord {
+    vector<Hex::Marker> board;
+    Hex::Marker side;
+    int move;
+    vector<int> wins;   // by linear index: -1 for occupied hexes and moves not simulated
+    Hex::Marker winner;
+};
+
+// encode records into chunks and append them to one file from a writer thread
+class SelfplayWriter {
+  public:
+    SelfplayWriter(const string &filename, int edge_len, int n_trials, size_t max_queued = 16);
+    ~SelfplayWriter() { close(); }
+    SelfplayWriter(const SelfplayWriter &) = delete;
+    SelfplayWriter &operator=(const SelfplayWriter &) = delete;
+
+    static const size_t chunk_bytes = 1 << 16;
+
+    // a game thread's chunk under construction
+    struct Chunk {
+        vector<uint8_t> bytes;
+        uint32_t n_records = 0;
+    };
+
+    void add(Chunk &chunk, const SelfplayRecord &rec); // hands the chunk over when it is full
+    void flush(Chunk &chunk);                            // hand over what there is
+    uint64_t records_written() const;
+    void close(); // write the queued chunks, the index and the trailer
+
+    static void encode(const SelfplayRecord &rec, vector<uint8_t> &out);
+
+  private:
+    ofstream outfile;
+    uint64_t offset;
+    vector<ChunkIndex> index;
+    uint64_t n_records = 0;
+
+    size_t max_queued;
+    deque<Chunk> queue;
+    mutable mutex lock;
+    condition_variable not_full, not_empty;
+    bool closing = false;
+    bool closed = false;
+    thread writer;
+
+    void run();
+};
+
+class SelfplayReader {
+  public:
+    bool open(const string &filename); // false if not a self-play file
+    int get_edge_len() const { return header.edge_len; }
+    size_t n_chunks() const { return index.size(); }
+    uint64_t n_records() const;
+    bool read_chunk(size_t i, vector<SelfplayRecord> &records); // false if damaged
+
+    static size_t decode(const uint8_t *bytes, size_t len, int edge_len, SelfplayRecord &rec); // bytes used or 0
+
+  private:
+    ifstream infile;
+    PlayHeader header;
+    vector<ChunkIndex> index;
+};
+
+// default file name of the self-play records for a board size
+inline string selfplay_filename(int edge_len)
+{
+    return "Hex Selfplay " + to_string(edge_len) + "x" + to_string(edge_len) + ".bin";
+}
+
+// play n_games on n_threads (0 for all cpus) and write their records: returns the number of records
+uint64_t run_selfplay(int edge_len, int n_games, int n_trials, int n_threads, const string &filename);
+
+#endif
@@ -0,0 +1,148 @@
+// ##########################################################################
+// #             Definition/Declaration of Class SparseMatrix
+// ##########################################################################
+
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+/*
+A symmetric sparse matrix with a fixed pattern and a conjugate gradient solver.
+
+The pattern (which off-diagonal entries can be non-zero) is set once with set_pattern
+from the neighbor lists of the nodes, stored in compressed rows:
+    row_start[i] .. row_start[i + 1]   the entries of row i
+    cols[k], vals[k]                   column and value of entry k
+    diag[i]                            the diagonal, kept apart for the preconditioner
+After that only the values change: clear_values and add_entry fill in a new matrix
+without allocating, so one matrix serves every position of a game.
+
+solve_cg solves A x = b for a symmetric positive definite A by conjugate gradient with the
+diagonal (Jacobi) preconditioner. x holds the starting guess: passing the solution of a
+similar system (the position before the last move) cuts the number of iterations.
+It stops when |r| <= tol * |b| and returns the number of iterations.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+class SparseMatrix {
+  public:
+    vector<int> row_start;
+    vector<int> cols;
+    vector<double> vals;
+    vector<double> diag;
+
+    // nbrs[i] lists the columns of the off-diagonal entries of row i
+    void set_pattern(const vector<vector<int>> &nbrs)
+    {
+        int n = nbrs.size();
+        row_start.assign(n + 1, 0);
+        cols.clear();
+        for (int i = 0; i != n; ++i) {
+            for (int j : nbrs[i])
+                cols.push_back(j);
+            row_start[i + 1] = cols.size();
+        }
+        vals.assign(cols.size(), 0.0);
+        diag.assign(n, 0.0);
+        r.assign(n, 0.0);
+        z.assign(n, 0.0);
+        p.assign(n, 0.0);
+        ap.assign(n, 0.0);
+    }
+
+    int size() const { return diag.size(); }
+
+    void clear_values()
+    {
+        fill(vals.begin(), vals.end(), 0.0);
+        fill(diag.begin(), diag.end(), 0.0);
+    }
+
+    // add v to entry (i, j): j must be in the pattern of row i
+    void add_entry(int i, int j, double v)
+    {
+        if (i == j) {
+            diag[i] += v;
+            return;
+        }
+        for (int k = row_start[i]; k != row_start[i + 1]; ++k) {
+            if (cols[k] == j) {
+                vals[k] += v;
+                return;
+            }
+        }
+    }
+
+    // y = A x
+    void multiply(const vector<double> &x, vector<double> &y) const
+    {
+        int n = size();
+        for (int i = 0; i != n; ++i) {
+            double sum = diag[i] * x[i];
+            for (int k = row_start[i]; k != row_start[i + 1]; ++k)
+                sum += vals[k] * x[cols[k]];
+            y[i] = sum;
+        }
+    }
+
+    int solve_cg(const vector<double> &b, vector<double> &x, double tol = 1e-8, int max_iter = 0)
+    {
+        int n = size();
+        if (max_iter == 0)
+            max_iter = 4 * n;
+
+        multiply(x, ap);
+        double b_norm = 0.0;
+        for (int i = 0; i != n; ++i) {
+            r[i] = b[i] - ap[i];
+            b_norm += b[i] * b[i];
+        }
+        b_norm = sqrt(b_norm);
+        if (b_norm == 0.0) {
+            fill(x.begin(), x.end(), 0.0);
+            return 0;
+        }
+
+        double rz = 0.0, r_norm = 0.0;
+        for (int i = 0; i != n; ++i) {
+            z[i] = r[i] / diag[i];
+            p[i] = z[i];
+            rz += r[i] * z[i];
+            r_norm += r[i] * r[i];
+        }
+
+        int iter = 0;
+        while (sqrt(r_norm) > tol * b_norm && iter < max_iter) {
+            multiply(p, ap);
+            double pap = 0.0;
+            for (int i = 0; i != n; ++i)
+                pap += p[i] * ap[i];
+            double alpha = rz / pap;
+
+            double rz_new = 0.0;
+            r_norm = 0.0;
+            for (int i = 0; i != n; ++i) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * ap[i];
+                z[i] = r[i] / diag[i];
+                rz_new += r[i] * z[i];
+                r_norm += r[i] * r[i];
+            }
+            double beta = rz_new / rz;
+            rz = rz_new;
+            for (int i = 0; i != n; ++i)
+                p[i] = z[i] + beta * p[i];
+            ++iter;
+        }
+        return iter;
+    }
+
+  private:
+    vector<double> r, z, p, ap; // solver scratch, sized by set_pattern
+};
+
+#endif
@@ -0,0 +1,95 @@
+// ##########################################################################
+// #             Definition/Declaration of Class SparseSet
+// ##########################################################################
+
+#ifndef SPARSE_SET_H
+#define SPARSE_SET_H
+
+/*
+A set of the integers 0 .. capacity-1 with O(1) insert, remove, membership test and undo.
+    dense:  the members, packed at the front in no particular order
+    sparse: for each integer, its index in dense
+remove swaps the member with the last member of dense and shrinks dense by one.
+sparse[val] keeps pointing at the slot val was removed from, so undo_remove puts
+val back in the same slot and restores the exact order: removes must be undone
+in reverse order (like a stack).
+
+The members can be read as a vector<int> with dense() or iterated directly.
+*/
+
+#include <vector>
+
+using namespace std;
+
+class SparseSet {
+  public:
+    SparseSet() = default;
+    explicit SparseSet(int capacity, bool full = false) { reset(capacity, full); }
+
+    // empty the set or fill it with every integer up to capacity
+    void reset(int capacity, bool full = false)
+    {
+        sparse.assign(capacity, 0);
+        members.clear();
+        members.reserve(capacity);
+        if (full) {
+            for (int i = 0; i != capacity; ++i) {
+                sparse[i] = i;
+                members.push_back(i);
+            }
+        }
+    }
+
+    void clear() { members.clear(); }
+
+    bool contains(int val) const
+    {
+        int slot = sparse[val];
+        return slot < members.size() && members[slot] == val;
+    }
+
+    void insert(int val) // val must not be a member
+    {
+        sparse[val] = members.size();
+        members.push_back(val);
+    }
+
+    void remove(int val) // val must be a member
+    {
+        int slot = sparse[val];
+        int last = members.back();
+        members[slot] = last;
+        sparse[last] = slot;
+        sparse[val] = slot; // remembered for undo_remove
+        members.pop_back();
+    }
+
+    void undo_remove(int val) // val must be the most recently removed member
+    {
+        int slot = sparse[val];
+        if (slot == members.size()) { // val was the last member
+            members.push_back(val);
+            return;
+        }
+        int moved = members[slot];
+        sparse[moved] = members.size();
+        members.push_back(moved);
+        members[slot] = val;
+    }
+
+    int index_of(int val) const { return sparse[val]; } // position of a member in dense()
+
+    int size() const { return members.size(); }
+    bool empty() const { return members.empty(); }
+    int operator[](int i) const { return members[i]; }
+    const vector<int> &dense() const { return members; }
+
+    vector<int>::const_iterator begin() const { return members.begin(); }
+    vector<int>::const_iterator end() const { return members.end(); }
+
+  private:
+    vector<int> sparse;
+    vector<int> members;
+};
+
+#endif
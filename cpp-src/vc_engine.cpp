@@ -0,0 +1,407 @@
+// ##########################################################################
+// #             Virtual connections by H-search
+// ##########################################################################
+
+#include "vc_engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+VcEngine::VcEngine(int edge_len)
+    : edge_len(edge_len), max_idx(edge_len * edge_len), topology(BoardTopology::for_size(edge_len))
+{
+    if (max_idx > max_cells)
+        throw invalid_argument("Board too large for the virtual connection engine.");
+
+    for (int i = 0; i < 2; i++) {
+        SideConns &s = sides[i];
+        s.marker = (i == 0 ? Hex::Marker::playerX : Hex::Marker::playerO);
+        int m = static_cast<int>(s.marker);
+        s.border.assign(max_idx, 0);
+        for (int idx : topology->start_border[m])
+            s.border[idx] |= 1;
+        for (int idx : topology->finish_border[m])
+            s.border[idx] |= 2;
+    }
+}
+
+// root of a node's group: a border is always the root of the groups touching it
+int VcEngine::find(const SideConns &s, int node) const
+{
+    if (s.parent[node] < 0)
+        return -1;
+    while (s.parent[node] != node)
+        node = s.parent[node];
+    return node;
+}
+
+void VcEngine::unite(SideConns &s, int a, int b)
+{
+    a = find(s, a);
+    b = find(s, b);
+    if (a != b)
+        s.parent[min(a, b)] = max(a, b); // the borders have the highest node numbers
+}
+
+bool VcEngine::add_vc(SideConns &s, int a, int b, const Carrier &c)
+{
+    if (a == b)
+        return false;
+    PairConns &pc = s.pairs[pair_key(a, b)];
+    for (const Carrier &v : pc.vcs) {
+        if ((v & ~c).none())
+            return false; // an existing VC needs no more than this one
+    }
+    pc.vcs.erase(remove_if(pc.vcs.begin(), pc.vcs.end(), [&](const Carrier &v) { return (c & ~v).none(); }),
+                 pc.vcs.end());
+    if (pc.vcs.size() >= max_vcs)
+        return false;
+    pc.vcs.push_back(c);
+    pc.scs.erase(remove_if(pc.scs.begin(), pc.scs.end(), [&](const Semi &sc) { return (c & ~sc.carrier).none(); }),
+                 pc.scs.end());
+    if (!pc.linked) {
+        pc.linked = true;
+        s.partners[a].push_back(b);
+        s.partners[b].push_back(a);
+    }
+    s.queue.push_back({a, b, c});
+    return true;
+}
+
+bool VcEngine::add_sc(SideConns &s, int a, int b, const Carrier &c, int key)
+{
+    if (a == b)
+        return false;
+    PairConns &pc = s.pairs[pair_key(a, b)];
+    for (const Carrier &v : pc.vcs) {
+        if ((v & ~c).none())
+            return false;
+    }
+    for (const Semi &sc : pc.scs) {
+        if ((sc.carrier & ~c).none())
+            return false;
+    }
+    pc.scs.erase(remove_if(pc.scs.begin(), pc.scs.end(), [&](const Semi &sc) { return (c & ~sc.carrier).none(); }),
+                 pc.scs.end());
+    if (pc.scs.size() >= max_scs)
+        return false;
+    pc.scs.push_back({c, key});
+    if (!pc.linked) {
+        pc.linked = true;
+        s.partners[a].push_back(b);
+        s.partners[b].push_back(a);
+    }
+
+    // OR rule: narrow the common hexes of the new SC with the others until none are left
+    Carrier common = c, all = c;
+    for (size_t i = 0; i + 1 < pc.scs.size(); i++) {
+        Carrier narrower = common & pc.scs[i].carrier;
+        if (narrower != common) {
+            common = narrower;
+            all |= pc.scs[i].carrier;
+            if (common.none()) {
+                add_vc(s, a, b, all);
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+void VcEngine::drop_pair(SideConns &s, int a, int b)
+{
+    s.pairs.erase(pair_key(a, b));
+    auto &pa = s.partners[a];
+    pa.erase(remove(pa.begin(), pa.end(), b), pa.end());
+    auto &pb = s.partners[b];
+    pb.erase(remove(pb.begin(), pb.end(), a), pb.end());
+}
+
+// adjacent nodes are connected with an empty carrier
+void VcEngine::add_base_connections(SideConns &s, int cell)
+{
+    int a = find(s, cell);
+    for (int k = 0; k < 6; k++) {
+        int nbr = topology->neighbor_table[6 * cell + k];
+        if (nbr < 0)
+            break;
+        int b = find(s, nbr);
+        if (b >= 0 && b != a)
+            add_vc(s, a, b, Carrier());
+    }
+    if (s.border[cell] & 1)
+        add_vc(s, a, find(s, start_node()), Carrier());
+    if (s.border[cell] & 2)
+        add_vc(s, a, find(s, finish_node()), Carrier());
+}
+
+// the AND rule for every queued VC, through either of its ends, until nothing new is found
+void VcEngine::closure(SideConns &s)
+{
+    while (!s.queue.empty()) {
+        Queued q = s.queue.back();
+        s.queue.pop_back();
+        for (int end_num = 0; end_num < 2; end_num++) {
+            int mid = (end_num == 0 ? q.a : q.b);
+            int end = (end_num == 0 ? q.b : q.a);
+            if (mid >= max_idx)
+                continue; // a border is never the middle of a connection
+            bool mid_empty = board[mid] == Hex::Marker::empty;
+
+            for (size_t i = 0; i < s.partners[mid].size(); i++) {
+                int z = s.partners[mid][i];
+                if (z == end || (z < max_idx && q.carrier[z]))
+                    continue;
+                auto it = s.pairs.find(pair_key(mid, z));
+                if (it == s.pairs.end())
+                    continue;
+                const vector<Carrier> &vcs = it->second.vcs;
+                for (size_t j = 0; j < vcs.size(); j++) {
+                    const Carrier &d = vcs[j];
+                    if ((q.carrier & d).any() || (end < max_idx && d[end]))
+                        continue;
+                    Carrier both = q.carrier | d;
+                    if (mid_empty) {
+                        both.set(mid);
+                        add_sc(s, end, z, both, mid);
+                    }
+                    else
+                        add_vc(s, end, z, both);
+                }
+            }
+        }
+    }
+}
+
+// the board comes from the moves played, not the positions, which may hold a search's fill-in markers
+void VcEngine::rebuild(const Hex &hb)
+{
+    board.assign(max_idx, Hex::Marker::empty);
+    for (const Hex::Move &mv : hb.get_move_history())
+        board[(mv.row - 1) * edge_len + (mv.col - 1)] = mv.player;
+
+    for (SideConns &s : sides) {
+        s.parent.resize(max_idx + 2);
+        iota(s.parent.begin(), s.parent.end(), 0);
+        for (int idx = 0; idx < max_idx; idx++) {
+            if (board[idx] != Hex::Marker::empty && board[idx] != s.marker)
+                s.parent[idx] = -1;
+        }
+        for (int idx = 0; idx < max_idx; idx++) {
+            if (board[idx] != s.marker)
+                continue;
+            for (int k = 0; k < 6; k++) {
+                int nbr = topology->neighbor_table[6 * idx + k];
+                if (nbr >= 0 && board[nbr] == s.marker)
+                    unite(s, idx, nbr);
+            }
+            if (s.border[idx] & 1)
+                unite(s, idx, start_node());
+            if (s.border[idx] & 2)
+                unite(s, idx, finish_node());
+        }
+
+        s.pairs.clear();
+        s.partners.assign(max_idx + 2, {});
+        s.queue.clear();
+        for (int idx = 0; idx < max_idx; idx++) {
+            if (s.parent[idx] >= 0)
+                add_base_connections(s, idx);
+        }
+        closure(s);
+    }
+    applied = hb.get_move_history();
+}
+
+void VcEngine::play(Hex::Marker mover, int cell)
+{
+    board[cell] = mover;
+
+    // the other player loses the hex and every connection through it
+    SideConns &o = side_of(mover == Hex::Marker::playerX ? Hex::Marker::playerO : Hex::Marker::playerX);
+    vector<int> gone(o.partners[cell]);
+    for (int z : gone)
+        drop_pair(o, cell, z);
+    o.parent[cell] = -1;
+    vector<pair<int, int>> emptied;
+    for (auto &kv : o.pairs) {
+        PairConns &pc = kv.second;
+        pc.vcs.erase(remove_if(pc.vcs.begin(), pc.vcs.end(), [&](const Carrier &v) { return v[cell]; }), pc.vcs.end());
+        pc.scs.erase(remove_if(pc.scs.begin(), pc.scs.end(), [&](const Semi &sc) { return sc.carrier[cell]; }),
+                     pc.scs.end());
+        if (pc.vcs.empty() && pc.scs.empty())
+            emptied.emplace_back(kv.first / (max_idx + 2), kv.first % (max_idx + 2));
+    }
+    for (const auto &ab : emptied)
+        drop_pair(o, ab.first, ab.second);
+
+    // the mover's groups next to the hex merge: move their connections to the merged group
+    SideConns &s = side_of(mover);
+    vector<int> merged{cell};
+    for (int k = 0; k < 6; k++) {
+        int nbr = topology->neighbor_table[6 * cell + k];
+        if (nbr >= 0 && board[nbr] == mover)
+            merged.push_back(find(s, nbr));
+    }
+    if (s.border[cell] & 1)
+        merged.push_back(find(s, start_node()));
+    if (s.border[cell] & 2)
+        merged.push_back(find(s, finish_node()));
+    for (int node : merged)
+        unite(s, cell, node);
+    int root = find(s, cell);
+
+    for (int node : merged) {
+        if (node == root)
+            continue;
+        vector<int> nodes(s.partners[node]);
+        for (int z : nodes) {
+            auto it = s.pairs.find(pair_key(node, z));
+            if (it == s.pairs.end())
+                continue;
+            PairConns pc = move(it->second);
+            drop_pair(s, node, z);
+            int zr = find(s, z);
+            if (zr == root)
+                continue; // now inside the merged group
+            for (const Carrier &v : pc.vcs)
+                add_vc(s, root, zr, v);
+            for (const Semi &sc : pc.scs)
+                add_sc(s, root, zr, sc.carrier, sc.key);
+        }
+    }
+
+    // carriers through the hex shrink; an SC keyed at the hex is now a VC
+    vector<Queued> promoted;
+    for (auto &kv : s.pairs) {
+        int a = kv.first / (max_idx + 2), b = kv.first % (max_idx + 2);
+        PairConns &pc = kv.second;
+        for (Carrier &v : pc.vcs) {
+            if (v[cell]) {
+                v.reset(cell);
+                s.queue.push_back({a, b, v});
+            }
+        }
+        for (Semi &sc : pc.scs) {
+            if (sc.carrier[cell]) {
+                sc.carrier.reset(cell);
+                if (sc.key == cell)
+                    promoted.push_back({a, b, sc.carrier});
+            }
+        }
+        pc.scs.erase(remove_if(pc.scs.begin(), pc.scs.end(), [&](const Semi &sc) { return sc.key == cell; }),
+                     pc.scs.end());
+    }
+    for (const Queued &q : promoted)
+        add_vc(s, q.a, q.b, q.carrier);
+
+    // the merged group's old connections can combine with the new ones
+    for (int z : s.partners[root]) {
+        auto it = s.pairs.find(pair_key(root, z));
+        if (it != s.pairs.end()) {
+            for (const Carrier &v : it->second.vcs)
+                s.queue.push_back({root, z, v});
+        }
+    }
+    add_base_connections(s, cell);
+    closure(s);
+}
+
+void VcEngine::sync(const Hex &hb)
+{
+    auto start = chrono::steady_clock::now();
+    const vector<Hex::Move> &history = hb.get_move_history();
+
+    bool extends = board.size() == max_idx && history.size() >= applied.size();
+    for (size_t i = 0; extends && i < applied.size(); i++) {
+        extends = history[i].player == applied[i].player && history[i].row == applied[i].row &&
+                  history[i].col == applied[i].col;
+    }
+
+    if (!extends) {
+        rebuild(hb);
+    }
+    else {
+        for (size_t i = applied.size(); i < history.size(); i++) {
+            const Hex::Move &mv = history[i];
+            play(mv.player, (mv.row - 1) * edge_len + (mv.col - 1));
+            applied.push_back(mv);
+        }
+    }
+    count();
+    stats.secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void VcEngine::count()
+{
+    stats.n_vcs = stats.n_scs = 0;
+    for (const SideConns &s : sides) {
+        for (const auto &kv : s.pairs) {
+            stats.n_vcs += kv.second.vcs.size();
+            stats.n_scs += kv.second.scs.size();
+        }
+    }
+}
+
+bool VcEngine::connected(Hex::Marker side) const
+{
+    const SideConns &s = side_of(side);
+    int a = find(s, start_node()), b = find(s, finish_node());
+    if (a == b)
+        return true;
+    auto it = s.pairs.find(pair_key(a, b));
+    return it != s.pairs.end() && !it->second.vcs.empty();
+}
+
+int VcEngine::winning_move(Hex::Marker side) const
+{
+    const SideConns &s = side_of(side);
+    auto it = s.pairs.find(pair_key(find(s, start_node()), find(s, finish_node())));
+    if (it == s.pairs.end() || it->second.scs.empty())
+        return -1;
+    return it->second.scs.front().key;
+}
+
+// the hexes in every carrier of the opponent's connections between its borders
+bool VcEngine::must_play(Hex::Marker side, vector<int> &cells) const
+{
+    cells.clear();
+    const SideConns &o = side_of(side == Hex::Marker::playerX ? Hex::Marker::playerO : Hex::Marker::playerX);
+    int a = find(o, start_node()), b = find(o, finish_node());
+    if (a == b)
+        return false; // the opponent has already won
+    auto it = o.pairs.find(pair_key(a, b));
+    if (it == o.pairs.end())
+        return false;
+
+    Carrier common;
+    common.set();
+    for (const Carrier &v : it->second.vcs)
+        common &= v;
+    for (const Semi &sc : it->second.scs)
+        common &= sc.carrier;
+    for (int idx = 0; idx < max_idx; idx++) {
+        if (common[idx] && board[idx] == Hex::Marker::empty)
+            cells.push_back(idx);
+    }
+    return !cells.empty(); // nothing in common: every move loses, so don't restrict
+}
+
+// fill must_play for evaluate_moves from the engine; vc_win is a move that wins outright
+void Hex::find_must_play(Marker side)
+{
+    must_play.clear();
+    vc_engine->sync(*this);
+    vc_win = vc_engine->winning_move(side);
+    if (vc_win >= 0)
+        return;
+    vector<int> cells;
+    if (vc_engine->must_play(side, cells)) {
+        for (int idx : cells)
+            must_play.insert(idx);
+    }
+}
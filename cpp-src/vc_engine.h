@@ -0,0 +1,126 @@
+// ##########################################################################
+// #             Definition/Declaration of Class VcEngine
+// ##########################################################################
+
+#ifndef VC_ENGINE_H
+#define VC_ENGINE_H
+
+/*
+Virtual connections by H-search (Anshelevich). For each player the nodes are the player's
+groups of markers, its two borders and the empty hexes. Between two nodes
+    a full connection (VC) holds even if the opponent moves first
+    a semi connection (SC) holds if the player moves first, at its key hex
+and each has a carrier: the empty hexes it needs. Starting from adjacent nodes (empty carrier)
+two rules build the rest until nothing new is found:
+    AND  x-z and z-y with disjoint carriers give x-y: a VC when z is the player's group,
+         an SC with key z when z is an empty hex
+    OR   SCs between x and y whose carriers have nothing in common give a VC
+Bridges, the bridge to the border and the small edge templates come out of these rules.
+Each pair keeps at most max_vcs VCs and max_scs SCs, with no carrier that holds another.
+
+What the game uses:
+    connected    a VC between the player's borders: the player has won with best play
+    winning_move the key of an SC between the borders: moving there wins
+    must_play    if the opponent has VCs or SCs between its borders, a move outside the
+                 hexes common to all their carriers loses, so only those need simulating
+
+The engine follows the game through sync(hb): new moves update the connections in place.
+The opponent of the mover loses the connections through the hex. The mover's groups merge,
+its carriers shrink and an SC keyed at the hex becomes a VC; then the rules run again from
+the changed pairs only. A take back rebuilds from scratch.
+
+Carriers are bitsets of max_cells bits, so boards up to 15x15 are supported.
+Attach to a game with hb.vc_engine = &engine: evaluate_moves then skips moves outside
+the must-play region and scores a winning key as a win without simulating.
+*/
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "hex.h"
+
+using namespace std;
+
+class VcEngine {
+  public:
+    static const int max_cells = 256;
+    using Carrier = bitset<max_cells>;
+
+    struct Stats {
+        long n_vcs = 0;
+        long n_scs = 0;
+        double secs = 0.0; // time spent by the last sync
+    };
+
+    explicit VcEngine(int edge_len);
+
+    int max_vcs = 8;  // soft limits per pair of nodes
+    int max_scs = 16;
+
+    void sync(const Hex &hb); // bring the connections up to date with the board
+
+    bool connected(Hex::Marker side) const;       // side has a VC between its borders
+    int winning_move(Hex::Marker side) const;     // key of an SC between side's borders or -1
+    bool must_play(Hex::Marker side, vector<int> &cells) const; // side to move; false if no restriction
+
+    const Stats &get_stats() const { return stats; }
+    const vector<Hex::Marker> &get_board() const { return board; } // the stones the connections were found for
+
+  private:
+    struct Semi {
+        Carrier carrier; // includes the key
+        int key;
+    };
+
+    struct PairConns {
+        vector<Carrier> vcs;
+        vector<Semi> scs;
+        bool linked = false; // the nodes are in each other's partners
+    };
+
+    struct Queued {
+        int a, b;
+        Carrier carrier;
+    };
+
+    // connections of one player
+    struct SideConns {
+        Hex::Marker marker;
+        vector<uint8_t> border;      // 1 on the start border, 2 on the finish border
+        vector<int> parent;          // union-find over cells and the 2 borders; -1 for opponent hexes
+        vector<vector<int>> partners; // nodes that share a pair with each node
+        unordered_map<uint32_t, PairConns> pairs;
+        vector<Queued> queue;
+    };
+
+    int edge_len;
+    int max_idx;
+    shared_ptr<const BoardTopology> topology;
+    array<SideConns, 2> sides;
+    vector<Hex::Marker> board;
+    vector<Hex::Move> applied; // the moves the connections reflect
+    Stats stats;
+
+    int start_node() const { return max_idx; }
+    int finish_node() const { return max_idx + 1; }
+    uint32_t pair_key(int a, int b) const { return a < b ? uint32_t(a) * (max_idx + 2) + b : uint32_t(b) * (max_idx + 2) + a; }
+    SideConns &side_of(Hex::Marker m) { return sides[m == Hex::Marker::playerX ? 0 : 1]; }
+    const SideConns &side_of(Hex::Marker m) const { return sides[m == Hex::Marker::playerX ? 0 : 1]; }
+
+    int find(const SideConns &s, int node) const;
+    void unite(SideConns &s, int a, int b);
+    void rebuild(const Hex &hb);
+    void play(Hex::Marker mover, int cell);
+    void add_base_connections(SideConns &s, int cell);
+    bool add_vc(SideConns &s, int a, int b, const Carrier &c);
+    bool add_sc(SideConns &s, int a, int b, const Carrier &c, int key);
+    void drop_pair(SideConns &s, int a, int b);
+    void closure(SideConns &s);
+    void count();
+};
+
+#endif
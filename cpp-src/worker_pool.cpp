@@ -0,0 +1,298 @@
+// ##########################################################################
+// #             Worker pool pinned to cpus and the parallel move search
+// ##########################################################################
+
+#include "worker_pool.h"
+#include "hex.h"
+
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+vector<int> parse_cpu_list(const string &list)
+{
+    vector<int> cpus;
+    stringstream ss{list};
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty() || range == "\n")
+            continue;
+        size_t dash = range.find('-');
+        int first = stoi(range.substr(0, dash));
+        int last = (dash == string::npos ? first : stoi(range.substr(dash + 1)));
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// the first line of a file in /sys or "" if there is no such file
+static string read_line(const string &filename)
+{
+    ifstream in(filename);
+    string line;
+    getline(in, line);
+    return line;
+}
+
+// cpus the process may run on: all of them when that can't be found out
+static vector<int> allowed_cpus()
+{
+    vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    if (cpus.empty()) {
+        int n = max(1u, thread::hardware_concurrency());
+        for (int cpu = 0; cpu < n; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+CpuTopology CpuTopology::detect()
+{
+    CpuTopology topo;
+    vector<int> allowed = allowed_cpus();
+
+    for (int node = 0;; node++) {
+        string list = read_line("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if (list.empty())
+            break;
+        vector<int> cpus;
+        for (int cpu : parse_cpu_list(list))
+            if (is_in(cpu, allowed))
+                cpus.push_back(cpu);
+        if (!cpus.empty())
+            topo.node_cpus.push_back(cpus);
+    }
+
+    if (topo.node_cpus.empty()) { // no NUMA information: every cpu listed in /proc/cpuinfo on one node
+        vector<int> cpus;
+        ifstream in("/proc/cpuinfo");
+        string line;
+        while (getline(in, line)) {
+            if (line.compare(0, 9, "processor") == 0) {
+                int cpu = stoi(line.substr(line.find(':') + 1));
+                if (is_in(cpu, allowed))
+                    cpus.push_back(cpu);
+            }
+        }
+        topo.node_cpus.push_back(cpus.empty() ? allowed : cpus);
+    }
+    return topo;
+}
+
+int CpuTopology::n_cpus() const
+{
+    int n = 0;
+    for (const auto &cpus : node_cpus)
+        n += cpus.size();
+    return n;
+}
+
+int CpuTopology::node_of(int cpu) const
+{
+    for (int node = 0; node != node_cpus.size(); node++)
+        if (is_in(cpu, node_cpus[node]))
+            return node;
+    return -1;
+}
+
+// one cpu per physical core first, then the hyperthread siblings; nodes take turns
+vector<int> CpuTopology::worker_cpus(int n_workers) const
+{
+    vector<vector<int>> node_order;
+    for (const auto &cpus : node_cpus) {
+        vector<int> firsts, seconds;
+        for (int cpu : cpus) {
+            string siblings = read_line("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/thread_siblings_list");
+            vector<int> sib = parse_cpu_list(siblings);
+            if (sib.empty() || sib[0] == cpu)
+                firsts.push_back(cpu);
+            else
+                seconds.push_back(cpu);
+        }
+        firsts.insert(firsts.end(), seconds.begin(), seconds.end());
+        node_order.push_back(firsts);
+    }
+
+    vector<int> order;
+    for (int i = 0; order.size() < n_cpus(); i++)
+        for (const auto &cpus : node_order)
+            if (i < cpus.size())
+                order.push_back(cpus[i]);
+
+    vector<int> result(n_workers);
+    for (int w = 0; w < n_workers; w++)
+        result[w] = order[w % order.size()];
+    return result;
+}
+
+bool pin_thread_to_cpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+WorkerPool::WorkerPool(int n_workers, bool pin) : topology(CpuTopology::detect())
+{
+    if (n_workers <= 0)
+        n_workers = topology.n_cpus();
+    cpus = topology.worker_cpus(n_workers);
+    if (!pin)
+        cpus.assign(n_workers, -1);
+
+    threads.reserve(n_workers);
+    for (int w = 0; w < n_workers; w++)
+        threads.emplace_back(&WorkerPool::worker_loop, this, w, pin);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto &t : threads)
+        t.join();
+}
+
+void WorkerPool::run_job(void (*fn)(void *, int), void *arg)
+{
+    unique_lock<mutex> lock(mtx);
+    job_fn = fn;
+    job_arg = arg;
+    n_running = size();
+    generation++;
+    start_cv.notify_all();
+    done_cv.wait(lock, [this] { return n_running == 0; });
+}
+
+void WorkerPool::worker_loop(int worker, bool pin)
+{
+    if (pin) // before the worker touches any memory, so its memory is on its own node
+        pin_thread_to_cpu(cpus[worker]);
+    long done = 0;
+    while (true) {
+        unique_lock<mutex> lock(mtx);
+        start_cv.wait(lock, [&] { return stopping || generation != done; });
+        if (stopping)
+            return;
+        done = generation;
+        lock.unlock();
+
+        job_fn(job_arg, worker);
+
+        lock.lock();
+        if (--n_running == 0)
+            done_cv.notify_one();
+    }
+}
+
+//
+// the parallel move search: each worker owns a Hex built on its own thread
+//
+
+// workers[w] is created by worker w so its board, rng and scratch memory are on that worker's node
+void Hex::use_worker_pool(WorkerPool *worker_pool)
+{
+    pool = worker_pool;
+    workers.clear();
+    if (pool == nullptr)
+        return;
+
+    workers.resize(pool->size());
+    pool->run([this](int w) {
+        workers[w] = make_unique<Hex>(edge_len);
+        workers[w]->make_board();
+        workers[w]->reseed(splitmix64(seed + w + 1));
+    });
+    shared_wins = vector<PaddedCounter>(max_idx);
+}
+
+// bring a worker to the same position by taking back and replaying only the moves that differ
+void Hex::copy_position(const Hex &from)
+{
+    int same = 0;
+    while (same < move_history.size() && same < from.move_history.size() &&
+           move_history[same].player == from.move_history[same].player &&
+           move_history[same].row == from.move_history[same].row &&
+           move_history[same].col == from.move_history[same].col)
+        same++;
+    while (move_history.size() > same)
+        unmake_move();
+    for (int i = same; i < from.move_history.size(); i++) {
+        const Move &mv = from.move_history[i];
+        make_move(mv.player, rc2l(mv.row, mv.col));
+    }
+}
+
+// split the trials among the workers; every worker runs evaluate_moves on its own board
+// and adds its wins to padded counters. Dead cell pruning and symmetric positions give
+// every worker the same candidates, so the sums line up with empty_idxs.
+const vector<int> &Hex::evaluate_moves_parallel(Marker computer_marker, int n_trials, Marker person_marker)
+{
+    int n_workers = pool->size();
+    int n_empty = empty_idxs.size();
+    for (int i = 0; i < n_empty; i++)
+        shared_wins[i].n.store(0, memory_order_relaxed);
+
+    if (vc_engine != nullptr)
+        find_must_play(computer_marker); // the workers have no engine: they get the result
+    if (max_candidates > 0 && must_play.empty() && candidates.empty())
+        find_candidates(computer_marker, empty_idxs); // once here rather than on every worker
+
+    pool->run([&](int w) {
+        Hex &worker = *workers[w];
+        worker.must_play = must_play;
+        worker.candidates = candidates;
+        worker.vc_win = vc_win;
+        worker.batch_playouts = batch_playouts;
+        worker.prune_cells = prune_cells;
+        worker.bitmask_playouts = bitmask_playouts;
+        worker.balanced_split_playouts = balanced_split_playouts;
+        worker.bridge_playouts = bridge_playouts;
+        worker.distance_cutoff = distance_cutoff;
+        worker.copy_position(*this);
+
+        int trials = n_trials / n_workers + (w < n_trials % n_workers ? 1 : 0);
+        if (trials == 0)
+            return;
+        const vector<int> &wins = worker.evaluate_moves(computer_marker, trials, person_marker);
+        for (int i = 0; i < n_empty; i++)
+            shared_wins[i].n.fetch_add(wins[i], memory_order_relaxed);
+    });
+
+    must_play.clear();
+    candidates.clear();
+    vc_win = -1;
+
+    // a pruned move is -1 for every worker that ran; don't let the sum look like a score
+    int n_ran = min(n_workers, n_trials);
+    wins_per_move.resize(n_empty);
+    for (int i = 0; i < n_empty; i++) {
+        long sum = shared_wins[i].n.load(memory_order_relaxed);
+        wins_per_move[i] = (sum == -n_ran ? -1 : int(sum));
+    }
+    return wins_per_move;
+}
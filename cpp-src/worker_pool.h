@@ -0,0 +1,99 @@
+// ##########################################################################
+// #             Definition/Declaration of Class WorkerPool
+// ##########################################################################
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+/*
+A pool of worker threads for the simulation, each pinned to its own cpu.
+
+CpuTopology reads the machine layout on Linux:
+    /sys/devices/system/node/nodeN/cpulist                       cpus of each NUMA node
+    /sys/devices/system/cpu/cpuN/topology/thread_siblings_list   hyperthreads sharing a core
+    /proc/cpuinfo                                                fallback: all cpus on node 0
+Only the cpus this process is allowed to run on are used (sched_getaffinity).
+
+Workers are assigned one physical core at a time, alternating between nodes, so a pool
+smaller than the machine spreads its memory traffic over every socket and only uses the
+second hyperthread of a core when every core has a worker.
+
+Each worker pins itself before it does anything else. Memory belongs to the NUMA node of the
+thread that first writes it, so per-worker state (board, rng, scratch buffers) must be
+created inside a job running on the worker, not by the thread that owns the pool:
+    pool.run([&](int w) { state[w] = make_unique<Hex>(size); state[w]->make_board(); });
+
+run() calls job(worker) once on every worker and returns when all of them are done.
+The job is passed without being copied into a std::function, so running a job allocates nothing.
+
+PaddedCounter is a counter on its own cache line: workers adding their results to
+neighboring counters in an array don't slow each other down through false sharing.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "helpers.h"
+
+using namespace std;
+
+struct CpuTopology {
+    vector<vector<int>> node_cpus; // allowed cpus of each NUMA node: at least one node
+
+    static CpuTopology detect();
+    int n_cpus() const;
+    vector<int> worker_cpus(int n_workers) const; // cpu for each worker, in the order described above
+    int node_of(int cpu) const;                   // -1 if unknown
+};
+
+// parse a kernel cpu list like "0-3,8,10-11"
+vector<int> parse_cpu_list(const string &list);
+
+// run the calling thread only on cpu from now on: false if it can't be done
+bool pin_thread_to_cpu(int cpu);
+
+struct alignas(cache_line_size) PaddedCounter {
+    atomic<long> n{0};
+};
+
+class WorkerPool {
+  public:
+    explicit WorkerPool(int n_workers = 0, bool pin = true); // 0: one worker per allowed cpu
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    int size() const { return int(threads.size()); }
+    int cpu_of(int worker) const { return cpus[worker]; } // -1 if not pinned
+    int node_of(int worker) const { return topology.node_of(cpus[worker]); }
+    const CpuTopology &get_topology() const { return topology; }
+
+    template <typename Job> void run(Job &&job)
+    {
+        using J = typename remove_reference<Job>::type;
+        run_job([](void *j, int worker) { (*static_cast<J *>(j))(worker); }, &job);
+    }
+
+  private:
+    CpuTopology topology;
+    vector<int> cpus;
+    vector<thread> threads;
+
+    mutex mtx;
+    condition_variable start_cv;
+    condition_variable done_cv;
+    void (*job_fn)(void *, int) = nullptr;
+    void *job_arg = nullptr;
+    long generation = 0; // counts jobs: a worker runs each generation once
+    int n_running = 0;
+    bool stopping = false;
+
+    void run_job(void (*fn)(void *, int), void *arg);
+    void worker_loop(int worker, bool pin);
+};
+
+#endif
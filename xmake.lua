@@ -2,12 +2,26 @@ add_rules("mode.release")
 
 target("hexcpp") 
     set_kind("binary")
-    add_files("cpp-src/hex.cpp", "cpp-src/game_play.cpp", "cpp-src/hex_board.cpp", "cpp-src/hex_board.cpp")
+    add_files("cpp-src/hex.cpp", "cpp-src/game_play.cpp", "cpp-src/hex_board.cpp", "cpp-src/board_render.cpp", "cpp-src/board_topology.cpp", "cpp-src/game_record.cpp",
+              "cpp-src/analysis.cpp", "cpp-src/opening_book.cpp",
+              "cpp-src/eval_cache.cpp", "cpp-src/cell_analysis.cpp", "cpp-src/path_eval.cpp", "cpp-src/resistance.cpp", "cpp-src/large_board.cpp", "cpp-src/alphabeta.cpp", "cpp-src/dfpn.cpp", "cpp-src/vc_engine.cpp", "cpp-src/nn_eval.cpp", "cpp-src/selfplay.cpp",
+              "cpp-src/playout_batch.cpp", "cpp-src/playout_bitmask.cpp", "cpp-src/worker_pool.cpp", "cpp-src/game_server.cpp")
     set_languages("cxx17")
     set_optimize("fastest")
+    add_syslinks("pthread")  -- worker threads for batch analysis and the book builder
     -- add_cxxflags("-flto")  -- supposed to be linker optimization; doesn't really do much
             -- these don't work... -fprofile-instr-generate and -fprofile-instr-use
 
+target("hexbench")  -- times the move search and counts allocations: hexbench [n_trials] [size ...]
+    set_kind("binary")
+    add_files("cpp-src/hex_bench.cpp", "cpp-src/game_play.cpp", "cpp-src/hex_board.cpp", "cpp-src/board_render.cpp", "cpp-src/board_topology.cpp", "cpp-src/game_record.cpp",
+              "cpp-src/analysis.cpp", "cpp-src/opening_book.cpp",
+              "cpp-src/eval_cache.cpp", "cpp-src/cell_analysis.cpp", "cpp-src/path_eval.cpp", "cpp-src/resistance.cpp", "cpp-src/large_board.cpp", "cpp-src/alphabeta.cpp", "cpp-src/dfpn.cpp", "cpp-src/vc_engine.cpp", "cpp-src/nn_eval.cpp", "cpp-src/selfplay.cpp",
+              "cpp-src/playout_batch.cpp", "cpp-src/playout_bitmask.cpp", "cpp-src/worker_pool.cpp", "cpp-src/game_server.cpp")
+    set_languages("cxx17")
+    set_optimize("fastest")
+    add_syslinks("pthread")
+
 target("hexnim") 
     set_kind("binary")
     add_files("nim-src/hex.nim")  -- all other files are included or imported